@@ -0,0 +1,158 @@
+#include "pch.h"
+
+#include "AffineTransform.h"
+
+#include <cassert>
+
+#include "MathHelpers.h"
+#include "MathBackend.h"
+
+namespace dae {
+	AffineTransform::AffineTransform(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t)
+		:m_AxisX{ xAxis }
+		,m_AxisY{ yAxis }
+		,m_AxisZ{ zAxis }
+		,m_Translation{ t }
+	{
+	}
+
+	Vector3 AffineTransform::TransformVector(const Vector3& v) const
+	{
+		return m_AxisX * v.x + m_AxisY * v.y + m_AxisZ * v.z;
+	}
+
+	Vector3 AffineTransform::TransformPoint(const Vector3& p) const
+	{
+		return m_AxisX * p.x + m_AxisY * p.y + m_AxisZ * p.z + m_Translation;
+	}
+
+	void AffineTransform::TransformPoints(std::span<const Vector3> points, std::span<Vector3> out) const
+	{
+		assert(out.size() >= points.size());
+		const Vector4 rows[4]{ { m_AxisX, 0.f }, { m_AxisY, 0.f }, { m_AxisZ, 0.f }, { m_Translation, 1.f } };
+		MathBackend::Active::TransformPoints(rows, points.data(), out.data(), points.size());
+	}
+
+	void AffineTransform::TransformVectors(std::span<const Vector3> vectors, std::span<Vector3> out) const
+	{
+		assert(out.size() >= vectors.size());
+		const Vector4 rows[4]{ { m_AxisX, 0.f }, { m_AxisY, 0.f }, { m_AxisZ, 0.f }, { m_Translation, 1.f } };
+		MathBackend::Active::TransformVectors(rows, vectors.data(), out.data(), vectors.size());
+	}
+
+	AffineTransform AffineTransform::Inverse() const
+	{
+		// Columns of the inverse are the cross products of the rows, divided by the determinant
+		const Vector3 c0{ Vector3::Cross(m_AxisY, m_AxisZ) };
+		const Vector3 c1{ Vector3::Cross(m_AxisZ, m_AxisX) };
+		const Vector3 c2{ Vector3::Cross(m_AxisX, m_AxisY) };
+
+		const float det{ Vector3::Dot(m_AxisX, c0) };
+		assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+		const float invDet{ 1.f / det };
+
+		AffineTransform inverse{
+			Vector3{ c0.x, c1.x, c2.x } * invDet,
+			Vector3{ c0.y, c1.y, c2.y } * invDet,
+			Vector3{ c0.z, c1.z, c2.z } * invDet,
+			Vector3::Zero
+		};
+		inverse.m_Translation = -inverse.TransformVector(m_Translation);
+		return inverse;
+	}
+
+	AffineTransform AffineTransform::InverseRigid() const
+	{
+		AffineTransform inverse{
+			{ m_AxisX.x, m_AxisY.x, m_AxisZ.x },
+			{ m_AxisX.y, m_AxisY.y, m_AxisZ.y },
+			{ m_AxisX.z, m_AxisY.z, m_AxisZ.z },
+			Vector3::Zero
+		};
+		inverse.m_Translation = -inverse.TransformVector(m_Translation);
+		return inverse;
+	}
+
+	Matrix AffineTransform::ToMatrix() const
+	{
+		return { m_AxisX, m_AxisY, m_AxisZ, m_Translation };
+	}
+
+	AffineTransform AffineTransform::CreateTranslation(float x, float y, float z)
+	{
+		return CreateTranslation({ x, y, z });
+	}
+
+	AffineTransform AffineTransform::CreateTranslation(const Vector3& t)
+	{
+		return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+	}
+
+	AffineTransform AffineTransform::CreateRotationX(float pitch)
+	{
+		return {
+			{ 1, 0, 0 },
+			{ 0, cosf(pitch), -sinf(pitch) },
+			{ 0, sinf(pitch), cosf(pitch) },
+			Vector3::Zero
+		};
+	}
+
+	AffineTransform AffineTransform::CreateRotationY(float yaw)
+	{
+		return {
+			{ cosf(yaw), 0, -sinf(yaw) },
+			{ 0, 1, 0 },
+			{ sinf(yaw), 0, cosf(yaw) },
+			Vector3::Zero
+		};
+	}
+
+	AffineTransform AffineTransform::CreateRotationZ(float roll)
+	{
+		return {
+			{ cosf(roll), sinf(roll), 0 },
+			{ -sinf(roll), cosf(roll), 0 },
+			{ 0, 0, 1 },
+			Vector3::Zero
+		};
+	}
+
+	AffineTransform AffineTransform::CreateScale(float sx, float sy, float sz)
+	{
+		return { { sx, 0, 0 }, { 0, sy, 0 }, { 0, 0, sz }, Vector3::Zero };
+	}
+
+	AffineTransform AffineTransform::CreateTRS(const Vector3& translation, const Quaternion& rotation, const Vector3& scale)
+	{
+		return {
+			rotation.Rotate(Vector3::UnitX) * scale.x,
+			rotation.Rotate(Vector3::UnitY) * scale.y,
+			rotation.Rotate(Vector3::UnitZ) * scale.z,
+			translation
+		};
+	}
+
+#pragma region Operator Overloads
+	AffineTransform AffineTransform::operator*(const AffineTransform& other) const
+	{
+		return {
+			other.TransformVector(m_AxisX),
+			other.TransformVector(m_AxisY),
+			other.TransformVector(m_AxisZ),
+			other.TransformPoint(m_Translation)
+		};
+	}
+
+	Matrix AffineTransform::operator*(const Matrix& m) const
+	{
+		return ToMatrix() * m;
+	}
+
+	bool AffineTransform::operator==(const AffineTransform& other) const
+	{
+		auto equal = [](const Vector3& a, const Vector3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; };
+		return equal(m_AxisX, other.m_AxisX) && equal(m_AxisY, other.m_AxisY) && equal(m_AxisZ, other.m_AxisZ) && equal(m_Translation, other.m_Translation);
+	}
+#pragma endregion
+}
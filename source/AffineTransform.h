@@ -0,0 +1,61 @@
+#pragma once
+#include <span>
+#include "Vector3.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+
+namespace dae
+{
+	// Affine transform, a 4x4 Matrix without the constant last column (0, 0, 0, 1).
+	// Same row vector convention as Matrix: p' = p * linear + translation.
+	// Composition and inverse skip the projective terms, promote with ToMatrix (or * Matrix) once the projection comes in.
+	struct AffineTransform
+	{
+		AffineTransform() = default;
+		AffineTransform(
+			const Vector3& xAxis,
+			const Vector3& yAxis,
+			const Vector3& zAxis,
+			const Vector3& t);
+
+		Vector3 TransformVector(const Vector3& v) const;
+		Vector3 TransformPoint(const Vector3& p) const;
+
+		// Batch versions, out needs at least as many elements as the input, can be done in place
+		void TransformPoints(std::span<const Vector3> points, std::span<Vector3> out) const;
+		void TransformVectors(std::span<const Vector3> vectors, std::span<Vector3> out) const;
+
+		// General affine inverse (scale, shear)
+		AffineTransform Inverse() const;
+		// Rotation + translation only, the linear part is orthonormal so its inverse is the transpose
+		AffineTransform InverseRigid() const;
+
+		Matrix ToMatrix() const;
+
+		Vector3 GetAxisX() const { return m_AxisX; }
+		Vector3 GetAxisY() const { return m_AxisY; }
+		Vector3 GetAxisZ() const { return m_AxisZ; }
+		Vector3 GetTranslation() const { return m_Translation; }
+
+		static AffineTransform CreateTranslation(float x, float y, float z);
+		static AffineTransform CreateTranslation(const Vector3& t);
+		static AffineTransform CreateRotationX(float pitch);
+		static AffineTransform CreateRotationY(float yaw);
+		static AffineTransform CreateRotationZ(float roll);
+		static AffineTransform CreateScale(float sx, float sy, float sz);
+		// Scale, then rotation, then translation
+		static AffineTransform CreateTRS(const Vector3& translation, const Quaternion& rotation, const Vector3& scale);
+
+		// this first, then other
+		AffineTransform operator*(const AffineTransform& other) const;
+		Matrix operator*(const Matrix& m) const;
+		bool operator==(const AffineTransform& other) const;
+		bool operator!=(const AffineTransform& other) const { return !(*this == other); }
+
+	private:
+		Vector3 m_AxisX{ 1, 0, 0 };
+		Vector3 m_AxisY{ 0, 1, 0 };
+		Vector3 m_AxisZ{ 0, 0, 1 };
+		Vector3 m_Translation{ 0, 0, 0 };
+	};
+}
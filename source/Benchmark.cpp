@@ -0,0 +1,337 @@
+#include "pch.h"
+#include "Benchmark.h"
+#include "MathBackend.h"
+#include "SIMD.h"
+#include "HelperFuncts.h"
+
+#include <chrono>
+#include <random>
+#include <iomanip>
+
+namespace dae
+{
+	namespace Benchmark
+	{
+		namespace
+		{
+			// Read back by the benchmarks so the optimizer can't drop the work
+			volatile float g_Sink{};
+
+			// Best of a few runs, in nanoseconds per operation
+			template<typename Function>
+			double Measure(size_t operationsPerRun, const Function& function)
+			{
+				using Clock = std::chrono::steady_clock;
+				constexpr int nrRuns{ 7 };
+
+				double best{ DBL_MAX };
+				for (int run{}; run < nrRuns; ++run)
+				{
+					const Clock::time_point start{ Clock::now() };
+					function();
+					const double ns{ std::chrono::duration<double, std::nano>(Clock::now() - start).count() };
+					best = std::min(best, ns / operationsPerRun);
+				}
+				return best;
+			}
+
+			// Largest errors of an approximation, relative only where the exact result is a normal float
+			struct ErrorStats
+			{
+				double maxAbsolute{};
+				double maxRelative{};
+
+				void Add(double approximation, double exact)
+				{
+					const double error{ std::abs(approximation - exact) };
+					maxAbsolute = std::max(maxAbsolute, error);
+					if (std::abs(exact) >= FLT_MIN)
+					{
+						maxRelative = std::max(maxRelative, error / std::abs(exact));
+					}
+				}
+			};
+
+			// A bound of 0 isn't checked
+			bool CheckBounds(const char* name, const ErrorStats& stats, double maxAbsolute, double maxRelative)
+			{
+				const bool isWithinBounds{ (maxAbsolute == 0.0 || stats.maxAbsolute <= maxAbsolute) && (maxRelative == 0.0 || stats.maxRelative <= maxRelative) };
+
+				std::cout << (isWithinBounds ? WHITE : RED) << "	" << std::left << std::setw(16) << name << std::right << std::scientific << std::setprecision(2);
+				std::cout << "absolute " << stats.maxAbsolute;
+				if (maxAbsolute > 0.0) std::cout << " (max " << maxAbsolute << ")";
+				std::cout << "   relative " << stats.maxRelative;
+				if (maxRelative > 0.0) std::cout << " (max " << maxRelative << ")";
+				std::cout << (isWithinBounds ? "   OK\n" : "   EXCEEDED\n") << std::defaultfloat << RESET;
+				return isWithinBounds;
+			}
+
+			void PrintResult(const char* name, double scalarNs, double simdNs)
+			{
+				std::cout << WHITE << "	" << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+					<< "scalar " << std::setw(8) << scalarNs << " ns"
+					<< "   simd " << std::setw(8) << simdNs << " ns"
+					<< "   x" << scalarNs / simdNs << '\n' << RESET;
+			}
+		}
+
+		void RunMathBenchmarks()
+		{
+#if defined(DAE_SIMD_SSE)
+			namespace Simd = MathBackend::SSE;
+			std::cout << YELLOW << "[BENCHMARK] Math backend, scalar vs " << (
+#if defined(DAE_SIMD_AVX)
+				"SSE/AVX"
+#else
+				"SSE"
+#endif
+				) << '\n' << RESET;
+
+			constexpr size_t nrMatrices{ 1024 };
+			constexpr size_t nrPoints{ 1 << 16 };
+
+			std::mt19937 random{ 1234 };
+			std::uniform_real_distribution<float> distribution{ -10.f, 10.f };
+			auto randomFloat = [&]() { return distribution(random); };
+
+			std::vector<Vector4> matrices(nrMatrices * 4);
+			for (Vector4& row : matrices) row = { randomFloat(), randomFloat(), randomFloat(), randomFloat() };
+
+			std::vector<Vector3> points(nrPoints);
+			for (Vector3& point : points) point = { randomFloat(), randomFloat(), randomFloat() };
+
+			std::vector<Vector4> matrixResults(nrMatrices * 4);
+			std::vector<Vector4> pointResults4(nrPoints);
+			std::vector<Vector3> pointResults3(nrPoints);
+
+			// Matrix x Matrix
+			{
+				auto multiply = [&](auto pMultiply)
+					{
+						return [&, pMultiply]()
+							{
+								for (size_t i{}; i + 1 < nrMatrices; ++i)
+								{
+									pMultiply(&matrices[i * 4], &matrices[(i + 1) * 4], &matrixResults[i * 4]);
+								}
+								g_Sink = matrixResults[0].x;
+							};
+					};
+				PrintResult("Matrix * Matrix", Measure(nrMatrices - 1, multiply(&MathBackend::Scalar::Multiply)), Measure(nrMatrices - 1, multiply(&Simd::Multiply)));
+			}
+
+			// Single point, the way Matrix::TransformPoint is called per vertex
+			{
+				auto transform = [&](auto pTransform)
+					{
+						return [&, pTransform]()
+							{
+								const Vector4* pRows{ matrices.data() };
+								for (size_t i{}; i < nrPoints; ++i)
+								{
+									pointResults4[i] = pTransform(pRows, points[i].x, points[i].y, points[i].z, 1.f);
+								}
+								g_Sink = pointResults4[0].x;
+							};
+					};
+				PrintResult("TransformPoint", Measure(nrPoints, transform(&MathBackend::Scalar::TransformPoint)), Measure(nrPoints, transform(static_cast<Vector4(*)(const Vector4*, float, float, float, float)>(&Simd::TransformPoint))));
+			}
+
+			// Batches
+			{
+				auto transformPoints4 = [&](auto pTransform)
+					{
+						return [&, pTransform]()
+							{
+								pTransform(matrices.data(), points.data(), pointResults4.data(), nrPoints);
+								g_Sink = pointResults4[0].x;
+							};
+					};
+				using TransformPoints4 = void(*)(const Vector4*, const Vector3*, Vector4*, size_t);
+				PrintResult("TransformPoints (Vector4)", Measure(nrPoints, transformPoints4(static_cast<TransformPoints4>(&MathBackend::Scalar::TransformPoints))), Measure(nrPoints, transformPoints4(static_cast<TransformPoints4>(&Simd::TransformPoints))));
+
+				auto transformPoints3 = [&](auto pTransform)
+					{
+						return [&, pTransform]()
+							{
+								pTransform(matrices.data(), points.data(), pointResults3.data(), nrPoints);
+								g_Sink = pointResults3[0].x;
+							};
+					};
+				using TransformPoints3 = void(*)(const Vector4*, const Vector3*, Vector3*, size_t);
+				PrintResult("TransformPoints (Vector3)", Measure(nrPoints, transformPoints3(static_cast<TransformPoints3>(&MathBackend::Scalar::TransformPoints))), Measure(nrPoints, transformPoints3(static_cast<TransformPoints3>(&Simd::TransformPoints))));
+				PrintResult("TransformVectors", Measure(nrPoints, transformPoints3(&MathBackend::Scalar::TransformVectors)), Measure(nrPoints, transformPoints3(&Simd::TransformVectors)));
+			}
+#else
+			std::cout << YELLOW << "[BENCHMARK] No SIMD backend in this build, nothing to compare\n" << RESET;
+#endif
+		}
+
+		void RunPresentBenchmarks()
+		{
+			std::cout << YELLOW << "[BENCHMARK] Present, per frame (render + get it into the window + window update)\n" << RESET;
+
+			if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0)
+			{
+				std::cout << RED << "	No video, skipped: " << SDL_GetError() << '\n' << RESET;
+				return;
+			}
+
+			struct Resolution
+			{
+				const char* name;
+				int width;
+				int height;
+			};
+			constexpr Resolution resolutions[]{ { "1080p", 1920, 1080 }, { "4K", 3840, 2160 } };
+
+			for (const Resolution& resolution : resolutions)
+			{
+				SDL_Window* pWindow{ SDL_CreateWindow("Present benchmark", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, resolution.width, resolution.height, SDL_WINDOW_BORDERLESS) };
+				SDL_Surface* pWindowSurface{ pWindow ? SDL_GetWindowSurface(pWindow) : nullptr };
+				if (!pWindowSurface)
+				{
+					std::cout << RED << "	" << resolution.name << " skipped, no window surface: " << SDL_GetError() << '\n' << RESET;
+					if (pWindow) SDL_DestroyWindow(pWindow);
+					continue;
+				}
+				SDL_PumpEvents();
+
+				// A back buffer in another layout than the window (what the renderer used to render into) and one in the same layout
+				const uint32_t windowFormat{ pWindowSurface->format->format };
+				const uint32_t otherFormat{ windowFormat == SDL_PIXELFORMAT_ABGR8888 ? SDL_PIXELFORMAT_ARGB8888 : SDL_PIXELFORMAT_ABGR8888 };
+				SDL_Surface* pOtherFormat{ SDL_CreateRGBSurfaceWithFormat(0, resolution.width, resolution.height, 32, otherFormat) };
+				SDL_Surface* pSameFormat{ SDL_CreateRGBSurfaceWithFormat(0, resolution.width, resolution.height, 32, windowFormat) };
+
+				// Every path renders the same frame, a fill stands in for the rasterizer writing every pixel once
+				uint8_t frameIdx{};
+				auto render = [&frameIdx](SDL_Surface* pSurface)
+					{
+						SDL_LockSurface(pSurface);
+						SDL_FillRect(pSurface, nullptr, SDL_MapRGB(pSurface->format, ++frameIdx, 0x40, 0x80));
+						SDL_UnlockSurface(pSurface);
+					};
+
+				const double convertMs{ Measure(1, [&]
+					{
+						render(pOtherFormat);
+						SDL_BlitSurface(pOtherFormat, 0, pWindowSurface, 0);
+						SDL_UpdateWindowSurface(pWindow);
+					}) / 1'000'000.0 };
+				const double copyMs{ Measure(1, [&]
+					{
+						render(pSameFormat);
+						SDL_BlitSurface(pSameFormat, 0, pWindowSurface, 0);
+						SDL_UpdateWindowSurface(pWindow);
+					}) / 1'000'000.0 };
+				// Rendered straight into the window surface, nothing to blit
+				const double zeroCopyMs{ Measure(1, [&]
+					{
+						render(pWindowSurface);
+						SDL_UpdateWindowSurface(pWindow);
+					}) / 1'000'000.0 };
+
+				std::cout << WHITE << "	" << std::left << std::setw(8) << resolution.name << std::right << std::fixed << std::setprecision(2)
+					<< "converting blit " << std::setw(6) << convertMs << " ms"
+					<< "   copy " << std::setw(6) << copyMs << " ms"
+					<< "   zero copy " << std::setw(6) << zeroCopyMs << " ms"
+					<< ", saves " << convertMs - zeroCopyMs << " / " << copyMs - zeroCopyMs << " ms\n" << RESET;
+
+				SDL_FreeSurface(pSameFormat);
+				SDL_FreeSurface(pOtherFormat);
+				SDL_DestroyWindow(pWindow);
+				SDL_PumpEvents();
+			}
+
+			SDL_QuitSubSystem(SDL_INIT_VIDEO);
+		}
+
+		bool RunAccuracyChecks()
+		{
+			std::cout << YELLOW << "[ACCURACY] Fast approximations against the standard library (in double)\n" << RESET;
+
+			// The bounds stated in MathHelpers.h, the SSE versions use the same polynomials
+			constexpr double log2MaxAbsolute{ 1.3e-5 };
+			constexpr double exp2MaxRelative{ 2e-7 };
+			constexpr double powMaxAbsolute{ 1.5e-4 };
+			constexpr double powMaxRelative{ 1.7e-4 };
+
+			// Every exponent of the normal floats, 4096 mantissas each
+			constexpr int nrMantissas{ 4096 };
+			std::vector<float> log2Inputs{};
+			for (int exponent{ -126 }; exponent <= 127; ++exponent)
+			{
+				for (int i{}; i < nrMantissas; ++i)
+				{
+					log2Inputs.push_back(ldexpf(1.f + static_cast<float>(i) / nrMantissas, exponent));
+				}
+			}
+
+			// The whole unclamped range, in steps of 1/4096
+			std::vector<float> exp2Inputs{};
+			for (int i{ -126 * nrMantissas }; i <= 127 * nrMantissas; ++i)
+			{
+				exp2Inputs.push_back(static_cast<float>(i) / nrMantissas);
+			}
+
+			// The specular range: base in (0, 1], exponent in [0, 25]
+			std::vector<float> powBases{};
+			std::vector<float> powExponents{};
+			constexpr int nrBases{ 1024 };
+			constexpr int nrExponents{ 250 };
+			for (int baseIdx{ 1 }; baseIdx <= nrBases; ++baseIdx)
+			{
+				for (int exponentIdx{}; exponentIdx <= nrExponents; ++exponentIdx)
+				{
+					powBases.push_back(static_cast<float>(baseIdx) / nrBases);
+					powExponents.push_back(25.f * exponentIdx / nrExponents);
+				}
+			}
+
+			bool isWithinBounds{ true };
+			{
+				ErrorStats log2Stats{};
+				ErrorStats exp2Stats{};
+				ErrorStats powStats{};
+				for (const float x : log2Inputs) log2Stats.Add(FastLog2(x), std::log2(static_cast<double>(x)));
+				for (const float y : exp2Inputs) exp2Stats.Add(FastExp2(y), std::exp2(static_cast<double>(y)));
+				for (size_t i{}; i < powBases.size(); ++i) powStats.Add(FastPow(powBases[i], powExponents[i]), std::pow(static_cast<double>(powBases[i]), static_cast<double>(powExponents[i])));
+
+				isWithinBounds &= CheckBounds("FastLog2", log2Stats, log2MaxAbsolute, 0.0);
+				isWithinBounds &= CheckBounds("FastExp2", exp2Stats, 0.0, exp2MaxRelative);
+				isWithinBounds &= CheckBounds("FastPow", powStats, powMaxAbsolute, powMaxRelative);
+			}
+
+#if defined(DAE_SIMD_SSE)
+			{
+				// Four at a time, a tail of up to 3 inputs is left out
+				ErrorStats log2Stats{};
+				ErrorStats exp2Stats{};
+				ErrorStats powStats{};
+				float results[4]{};
+				for (size_t i{}; i + 4 <= log2Inputs.size(); i += 4)
+				{
+					_mm_storeu_ps(results, SIMD::FastLog2(_mm_loadu_ps(&log2Inputs[i])));
+					for (size_t lane{}; lane < 4; ++lane) log2Stats.Add(results[lane], std::log2(static_cast<double>(log2Inputs[i + lane])));
+				}
+				for (size_t i{}; i + 4 <= exp2Inputs.size(); i += 4)
+				{
+					_mm_storeu_ps(results, SIMD::FastExp2(_mm_loadu_ps(&exp2Inputs[i])));
+					for (size_t lane{}; lane < 4; ++lane) exp2Stats.Add(results[lane], std::exp2(static_cast<double>(exp2Inputs[i + lane])));
+				}
+				for (size_t i{}; i + 4 <= powBases.size(); i += 4)
+				{
+					_mm_storeu_ps(results, SIMD::FastPow(_mm_loadu_ps(&powBases[i]), _mm_loadu_ps(&powExponents[i])));
+					for (size_t lane{}; lane < 4; ++lane) powStats.Add(results[lane], std::pow(static_cast<double>(powBases[i + lane]), static_cast<double>(powExponents[i + lane])));
+				}
+
+				isWithinBounds &= CheckBounds("FastLog2 (SSE)", log2Stats, log2MaxAbsolute, 0.0);
+				isWithinBounds &= CheckBounds("FastExp2 (SSE)", exp2Stats, 0.0, exp2MaxRelative);
+				isWithinBounds &= CheckBounds("FastPow (SSE)", powStats, powMaxAbsolute, powMaxRelative);
+			}
+#endif
+
+			return isWithinBounds;
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace dae
+{
+	namespace Benchmark
+	{
+		// Times the scalar and SIMD math backends against each other and prints the speedup per operation.
+		// Run the executable with --benchmark
+		void RunMathBenchmarks();
+
+		// Cost of getting a software frame into the window surface at 1080p and 4K:
+		// a converting blit (back buffer in a different format), a plain copy (same format) and zero copy.
+		void RunPresentBenchmarks();
+
+		// Sweeps FastLog2, FastExp2 and FastPow (scalar and SSE) against the standard library and checks the error bounds
+		// stated in MathHelpers.h. Returns false when one of them is exceeded.
+		bool RunAccuracyChecks();
+	}
+}
@@ -1,10 +1,13 @@
 #pragma once
 #include <cassert>
+#include <bitset>
+#include <chrono>
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
 
 #include "Math.h"
 #include "Timer.h"
+#include "InputEvent.h"
 
 namespace dae
 {
@@ -21,19 +24,29 @@ namespace dae
 		Vector3 up{ Vector3::UnitY };
 		Vector3 right{ Vector3::UnitX };
 
+		// Orientation is rebuilt from the accumulated angles, so it never drifts
 		float totalPitch{};
 		float totalYaw{};
+		Quaternion rotation{};
 
 		float nearPlane{ 0.1f };
 		float farPlane{ 100.f };
 
-		Matrix invViewMatrix{};
-		Matrix viewMatrix{};
+		AffineTransform invViewMatrix{};
+		AffineTransform viewMatrix{};
 		Matrix projectionMatrix{};
 
 		float baseMovementSpeed{ 15 };
 		float speedMultiplier{ 4 };
 
+		// Input state, built from the events of the input thread instead of polling SDL
+		std::bitset<SDL_NUM_SCANCODES> keysDown{};
+		uint32_t mouseButtons{};
+		int mouseDeltaX{};
+		int mouseDeltaY{};
+		// Keyboard movement is integrated up to every key event, a key held for part of a frame moves the camera for just that part
+		std::chrono::steady_clock::time_point lastMoveTime{};
+
 		inline bool ShouldVertexBeClipped(const Vector4& v) const
 		{
 			return v.x < -1.f || v.x > 1.f || v.y < -1.f || v.y > 1.f;
@@ -56,9 +69,13 @@ namespace dae
 			//ONB => invViewMatrix
 			//Inverse(ONB) => ViewMatrix
 
-			right = Vector3::Cross(Vector3::UnitY, forward);
-			up = Vector3::Cross(forward, right);
-			// https://gamedev.net/forums/topic/388559-getting-a-up-vector-from-only-having-a-forward-vector/.
+			// Yaw around the world up, pitch around the local right
+			rotation = Quaternion::CreateFromAxisAngle(Vector3::UnitY, totalYaw) * Quaternion::CreateFromAxisAngle(Vector3::UnitX, totalPitch);
+
+			// Orthonormal, so the view matrix is the rigid inverse
+			forward = rotation.Rotate(Vector3::UnitZ);
+			right = rotation.Rotate(Vector3::UnitX);
+			up = rotation.Rotate(Vector3::UnitY);
 
 			invViewMatrix =
 			{
@@ -68,7 +85,7 @@ namespace dae
 				origin
 			};
 
-			viewMatrix = Matrix::Inverse(invViewMatrix);
+			viewMatrix = invViewMatrix.InverseRigid();
 
 			//ViewMatrix => Matrix::CreateLookAtLH(...) [not implemented yet]
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixlookatlh
@@ -80,12 +97,12 @@ namespace dae
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixperspectivefovlh
 		}
 
-		const Matrix& GetViewMatrix() const
+		const AffineTransform& GetViewMatrix() const
 		{
 			return viewMatrix;
 		}
 
-		const Matrix& GetInverseViewMatrix() const
+		const AffineTransform& GetInverseViewMatrix() const
 		{
 			return invViewMatrix;
 		}
@@ -95,29 +112,94 @@ namespace dae
 			return projectionMatrix;
 		}
 
+		// Promoted to 4x4 here, where the projection comes in
 		Matrix GetWorldViewProjection() const
 		{
 			return GetViewMatrix() * GetProjectionMatrix();
 		}
 
-		void Update(const Timer* pTimer)
+		void HandleInput(const InputEvent& input)
+		{
+			const SDL_Event& e{ input.event };
+			switch (e.type)
+			{
+			case SDL_KEYDOWN:
+			case SDL_KEYUP:
+				// Up to the event the keys were still as they were
+				MoveWithKeyboard(input.timestamp);
+				keysDown[e.key.keysym.scancode] = e.type == SDL_KEYDOWN;
+				break;
+			case SDL_MOUSEMOTION:
+				mouseDeltaX += e.motion.xrel;
+				mouseDeltaY += e.motion.yrel;
+				break;
+			case SDL_MOUSEBUTTONDOWN:
+				mouseButtons |= SDL_BUTTON(e.button.button);
+				break;
+			case SDL_MOUSEBUTTONUP:
+				mouseButtons &= ~SDL_BUTTON(e.button.button);
+				break;
+			default: ;
+			}
+		}
+
+		// Called before the input of a simulation step is handed in.
+		// Time that isn't simulated (before the first step, a dropped hitch) doesn't move the camera.
+		void BeginStep(std::chrono::steady_clock::time_point stepStartTime)
 		{
-			const float deltaTime = pTimer->GetElapsed();
+			lastMoveTime = std::max(lastMoveTime, stepStartTime);
+		}
+
+		void MoveWithKeyboard(std::chrono::steady_clock::time_point time)
+		{
+			if (time <= lastMoveTime) return;
+
+			const float deltaTime{ std::chrono::duration<float>(time - lastMoveTime).count() };
+			lastMoveTime = time;
+
+			float movementSpeed{ baseMovementSpeed };
+#pragma region Shift
+			if (keysDown[SDL_SCANCODE_LSHIFT] || keysDown[SDL_SCANCODE_RSHIFT])
+			{
+				movementSpeed *= speedMultiplier;
+			}
+#pragma endregion 
+
+#pragma region KeyboardOnly Controls
+			if (keysDown[SDL_SCANCODE_W] || keysDown[SDL_SCANCODE_UP])
+			{
+				origin += forward * movementSpeed * deltaTime;
+			}
+			else if (keysDown[SDL_SCANCODE_S] || keysDown[SDL_SCANCODE_DOWN])
+			{
+				origin -= forward * movementSpeed * deltaTime;
+			}
+			if (keysDown[SDL_SCANCODE_D] || keysDown[SDL_SCANCODE_RIGHT])
+			{
+				origin += right * movementSpeed * deltaTime;
+			}
+			else if (keysDown[SDL_SCANCODE_A] || keysDown[SDL_SCANCODE_LEFT])
+			{
+				origin -= right * movementSpeed * deltaTime;
+			}
+#pragma endregion 
+		}
 
+		// One simulation step of deltaTime, ending at stepEndTime
+		void Update(float deltaTime, std::chrono::steady_clock::time_point stepEndTime)
+		{
 			//Camera Update Logic
 			//...
 
+			// The rest of the step, with the keys as they are now
+			MoveWithKeyboard(stepEndTime);
+
 			float movementSpeed{ baseMovementSpeed };
 			const float rotationSpeed{ 1 / 32.f };
-			//Keyboard Input
-			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
-
-#pragma region Shift
-			if (pKeyboardState[SDL_SCANCODE_LSHIFT] || pKeyboardState[SDL_SCANCODE_RSHIFT])
+			if (keysDown[SDL_SCANCODE_LSHIFT] || keysDown[SDL_SCANCODE_RSHIFT])
 			{
 				movementSpeed *= speedMultiplier;
 			}
-#pragma endregion 
 
 #pragma region FovControls
 			/*if (pKeyboardState[SDL_SCANCODE_LEFT])
@@ -136,28 +218,11 @@ namespace dae
 			}*/
 #pragma endregion 
 
-#pragma region KeyboardOnly Controls
-			if (pKeyboardState[SDL_SCANCODE_W] || pKeyboardState[SDL_SCANCODE_UP])
-			{
-				origin += forward * movementSpeed * deltaTime;
-			}
-			else if (pKeyboardState[SDL_SCANCODE_S] || pKeyboardState[SDL_SCANCODE_DOWN])
-			{
-				origin -= forward * movementSpeed * deltaTime;
-			}
-			if (pKeyboardState[SDL_SCANCODE_D] || pKeyboardState[SDL_SCANCODE_RIGHT])
-			{
-				origin += right * movementSpeed * deltaTime;
-			}
-			else if (pKeyboardState[SDL_SCANCODE_A] || pKeyboardState[SDL_SCANCODE_LEFT])
-			{
-				origin -= right * movementSpeed * deltaTime;
-			}
-#pragma endregion 
-
-			//Mouse Input
-			int mouseX{}, mouseY{};
-			const uint32_t mouseState = SDL_GetRelativeMouseState(&mouseX, &mouseY);
+			//Mouse Input, the motion of every event since the last step
+			const int mouseX{ mouseDeltaX }, mouseY{ mouseDeltaY };
+			const uint32_t mouseState{ mouseButtons };
+			mouseDeltaX = 0;
+			mouseDeltaY = 0;
 
 #pragma region Mousebased Movement
 			const constexpr float mouseBasedMovementMultiplier{ 3 };
@@ -179,8 +244,10 @@ namespace dae
 #pragma region Rotation
 			else if (mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT))
 			{
-				forward = Matrix::CreateRotationY(mouseX * rotationSpeed).TransformVector(forward);
-				forward = Matrix::CreateRotationX(-mouseY * rotationSpeed).TransformVector(forward);
+				// Pitch stays short of straight up/down, where yaw would flip
+				const float maxPitch{ 89.f * TO_RADIANS };
+				totalYaw += mouseX * rotationSpeed;
+				totalPitch = Clamp(totalPitch + mouseY * rotationSpeed, -maxPitch, maxPitch);
 			}
 #pragma endregion
 			//Update Matrices
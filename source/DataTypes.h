@@ -22,6 +22,23 @@ namespace dae
 		Vector3 tangent{};
 		ColorRGB color{ colors::White };
 		Vector3 viewDirection{};
+		Vector3 worldPosition{};
+	};
+
+	// 2x2 pixels shaded together, lanes are top left, top right, bottom left, bottom right.
+	// Lanes outside the coverage mask are helpers, only interpolated for the uv derivatives.
+	struct PixelQuad
+	{
+		static constexpr int LaneCount{ 4 };
+
+		Vertex_Out fragments[LaneCount]{};
+		uint32_t coverageMask{};
+
+		// uv change per pixel step in x and y
+		Vector2 uvDdx{};
+		Vector2 uvDdy{};
+
+		bool IsCovered(int lane) const { return coverageMask & (1u << lane); }
 	};
 
 	struct DirectionalLight
@@ -29,4 +46,21 @@ namespace dae
 		Vector3 direction{};
 		float intensity{};
 	};
+
+	enum class LightType
+	{
+		Point, Spot
+	};
+
+	struct LocalLight
+	{
+		LightType type{ LightType::Point };
+		Vector3 position{};
+		Vector3 direction{ 0.f, -1.f, 0.f };	// Spot only
+		ColorRGB color{ colors::White };
+		float intensity{ 1.f };
+		float range{ 10.f };				// No light beyond this distance
+		float cosInnerCone{ 1.f };			// Spot only
+		float cosOuterCone{ 0.f };			// Spot only
+	};
 }
\ No newline at end of file
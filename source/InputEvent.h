@@ -0,0 +1,18 @@
+#pragma once
+#include <chrono>
+#include <SDL_events.h>
+
+#include "SPSCQueue.h"
+
+namespace dae
+{
+	// SDL event as the input thread received it
+	struct InputEvent
+	{
+		SDL_Event event{};
+		std::chrono::steady_clock::time_point timestamp{};
+	};
+
+	// Input thread -> frame thread, drained every frame. Sized for a few frames of a 1000 Hz mouse.
+	using InputQueue = SPSCQueue<InputEvent, 1024>;
+}
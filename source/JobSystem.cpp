@@ -0,0 +1,256 @@
+#include "pch.h"
+#include "JobSystem.h"
+
+namespace dae
+{
+	struct JobState
+	{
+		JobSystem::JobFunction function{};
+		bool isBackground{ false };
+
+		// Unfinished dependencies, the job is queued when this hits 0
+		std::atomic<int> nrPendingDependencies{};
+
+		// Guards the continuations, so a job that gets a dependency added can't miss its completion
+		std::mutex mutex{};
+		std::vector<std::shared_ptr<JobState>> pContinuations{};
+		std::atomic<bool> isDone{ false };
+	};
+
+	namespace
+	{
+		thread_local const JobSystem* t_pJobSystem{ nullptr };
+		thread_local int t_QueueIdx{ -1 };
+	}
+
+	bool JobHandle::IsDone() const
+	{
+		return !m_pState || m_pState->isDone.load(std::memory_order_acquire);
+	}
+
+	JobSystem::JobSystem(int nrWorkers)
+	{
+		if (nrWorkers < 0)
+		{
+			nrWorkers = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+		}
+
+		t_pJobSystem = this;
+		t_QueueIdx = 0;
+
+		for (int i{}; i < nrWorkers + 1; ++i)
+		{
+			m_pQueues.push_back(std::make_unique<WorkQueue>());
+		}
+
+		m_Workers.reserve(nrWorkers);
+		for (int i{}; i < nrWorkers; ++i)
+		{
+			m_Workers.emplace_back([this, i] { WorkerLoop(i + 1); });
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		// Workers finish the queued jobs before they exit
+		{
+			std::lock_guard lock{ m_SleepMutex };
+			m_IsRunning = false;
+		}
+		m_WakeUp.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+
+		if (t_pJobSystem == this)
+		{
+			t_pJobSystem = nullptr;
+			t_QueueIdx = -1;
+		}
+	}
+
+	JobHandle JobSystem::Schedule(JobFunction function, std::initializer_list<JobHandle> dependencies)
+	{
+		auto pJob{ std::make_shared<JobState>() };
+		pJob->function = std::move(function);
+
+		// Held until every dependency is registered, so a dependency that finishes in between can't queue the job early
+		pJob->nrPendingDependencies = 1;
+		for (const JobHandle& dependency : dependencies)
+		{
+			if (!dependency.m_pState) continue;
+
+			std::lock_guard lock{ dependency.m_pState->mutex };
+			if (dependency.m_pState->isDone.load(std::memory_order_relaxed)) continue;
+
+			++pJob->nrPendingDependencies;
+			dependency.m_pState->pContinuations.push_back(pJob);
+		}
+
+		if (--pJob->nrPendingDependencies == 0)
+		{
+			Enqueue(pJob);
+		}
+		return JobHandle{ std::move(pJob) };
+	}
+
+	JobHandle JobSystem::ScheduleBackground(JobFunction function)
+	{
+		auto pJob{ std::make_shared<JobState>() };
+		pJob->function = std::move(function);
+		pJob->isBackground = true;
+
+		if (m_Workers.empty())
+		{
+			Execute(pJob);
+		}
+		else
+		{
+			Enqueue(pJob);
+		}
+		return JobHandle{ std::move(pJob) };
+	}
+
+	void JobSystem::Wait(const JobHandle& job)
+	{
+		const int queueIdx{ GetQueueIndex() };
+		while (!job.IsDone())
+		{
+			std::shared_ptr<JobState> pJob{ queueIdx >= 0 ? FindJob(queueIdx, false) : nullptr };
+			if (pJob)
+			{
+				Execute(pJob);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::Enqueue(std::shared_ptr<JobState> pJob)
+	{
+		if (pJob->isBackground)
+		{
+			std::lock_guard lock{ m_BackgroundQueue.mutex };
+			m_BackgroundQueue.pJobs.push_back(std::move(pJob));
+		}
+		else
+		{
+			// Threads outside of the job system hand their jobs to the creating thread's deque, the workers steal them from there
+			const int queueIdx{ GetQueueIndex() };
+			WorkQueue& queue{ *m_pQueues[queueIdx >= 0 ? queueIdx : 0] };
+			std::lock_guard lock{ queue.mutex };
+			queue.pJobs.push_back(std::move(pJob));
+		}
+
+		++m_NrQueuedJobs;
+		if (m_NrSleepingWorkers > 0)
+		{
+			// Taking the lock makes sure a worker that is about to sleep either sees the job or gets the notification
+			{
+				std::lock_guard lock{ m_SleepMutex };
+			}
+			m_WakeUp.notify_one();
+		}
+	}
+
+	std::shared_ptr<JobState> JobSystem::FindJob(int queueIdx, bool allowBackground)
+	{
+		std::shared_ptr<JobState> pJob{};
+
+		// 1. Own deque, newest first
+		{
+			WorkQueue& queue{ *m_pQueues[queueIdx] };
+			std::lock_guard lock{ queue.mutex };
+			if (!queue.pJobs.empty())
+			{
+				pJob = std::move(queue.pJobs.back());
+				queue.pJobs.pop_back();
+			}
+		}
+
+		// 2. Steal the oldest job of another thread, starting at the next one so the victims are spread out
+		const int nrQueues{ static_cast<int>(m_pQueues.size()) };
+		for (int i{ 1 }; !pJob && i < nrQueues; ++i)
+		{
+			WorkQueue& queue{ *m_pQueues[(queueIdx + i) % nrQueues] };
+			std::lock_guard lock{ queue.mutex };
+			if (!queue.pJobs.empty())
+			{
+				pJob = std::move(queue.pJobs.front());
+				queue.pJobs.pop_front();
+				m_NrStolenJobs.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		// 3. Background work
+		if (!pJob && allowBackground)
+		{
+			std::lock_guard lock{ m_BackgroundQueue.mutex };
+			if (!m_BackgroundQueue.pJobs.empty())
+			{
+				pJob = std::move(m_BackgroundQueue.pJobs.front());
+				m_BackgroundQueue.pJobs.pop_front();
+			}
+		}
+
+		if (pJob)
+		{
+			--m_NrQueuedJobs;
+		}
+		return pJob;
+	}
+
+	void JobSystem::Execute(const std::shared_ptr<JobState>& pJob)
+	{
+		pJob->function();
+		// Releases the captures right away
+		pJob->function = nullptr;
+		m_NrExecutedJobs.fetch_add(1, std::memory_order_relaxed);
+
+		std::vector<std::shared_ptr<JobState>> pContinuations{};
+		{
+			std::lock_guard lock{ pJob->mutex };
+			pJob->isDone.store(true, std::memory_order_release);
+			pContinuations.swap(pJob->pContinuations);
+		}
+
+		for (std::shared_ptr<JobState>& pContinuation : pContinuations)
+		{
+			if (--pContinuation->nrPendingDependencies == 0)
+			{
+				Enqueue(std::move(pContinuation));
+			}
+		}
+	}
+
+	void JobSystem::WorkerLoop(int queueIdx)
+	{
+		t_pJobSystem = this;
+		t_QueueIdx = queueIdx;
+
+		while (true)
+		{
+			if (std::shared_ptr<JobState> pJob{ FindJob(queueIdx, true) })
+			{
+				Execute(pJob);
+				continue;
+			}
+
+			std::unique_lock lock{ m_SleepMutex };
+			if (!m_IsRunning && m_NrQueuedJobs <= 0) return;
+
+			++m_NrSleepingWorkers;
+			m_WakeUp.wait(lock, [this] { return m_NrQueuedJobs > 0 || !m_IsRunning; });
+			--m_NrSleepingWorkers;
+		}
+	}
+
+	int JobSystem::GetQueueIndex() const
+	{
+		return t_pJobSystem == this ? t_QueueIdx : -1;
+	}
+}
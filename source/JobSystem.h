@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <initializer_list>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+namespace dae
+{
+	struct JobState;
+
+	// Reference to a scheduled job, used to wait on it or to make other jobs depend on it
+	class JobHandle final
+	{
+	public:
+		JobHandle() = default;
+
+		bool IsValid() const { return m_pState != nullptr; }
+		// An empty handle counts as done
+		bool IsDone() const;
+
+	private:
+		friend class JobSystem;
+		explicit JobHandle(std::shared_ptr<JobState> pState) : m_pState{ std::move(pState) } {}
+
+		std::shared_ptr<JobState> m_pState{};
+	};
+
+	/**
+	 * \brief Work-stealing job scheduler.
+	 * Every thread has its own deque, it pushes and pops at the back (most recent, still in cache) while idle threads steal from the front.
+	 * The thread that creates the job system gets a deque as well and runs jobs while it waits, so it is never idle during a parallel pass.
+	 * Background jobs (asset loading) live in a separate queue that only the workers pick up, a long decode can't end up on a thread that waits for a frame.
+	 */
+	class JobSystem final
+	{
+	public:
+		using JobFunction = std::function<void()>;
+
+		struct Stats
+		{
+			uint64_t executedJobs{};
+			uint64_t stolenJobs{};
+		};
+
+		// Worker count excludes the creating thread, -1 uses one worker per remaining hardware thread.
+		// 0 runs everything on the creating thread, the serial baseline for scaling tests.
+		explicit JobSystem(int nrWorkers = -1);
+		~JobSystem();
+
+		JobSystem(const JobSystem& other) = delete;
+		JobSystem& operator=(const JobSystem& other) = delete;
+		JobSystem(JobSystem&& other) = delete;
+		JobSystem& operator=(JobSystem&& other) = delete;
+
+		// Queued once all dependencies have finished
+		JobHandle Schedule(JobFunction function, std::initializer_list<JobHandle> dependencies = {});
+		// Without workers the job runs right away on the calling thread
+		JobHandle ScheduleBackground(JobFunction function);
+
+		// Runs other jobs on the calling thread until the job has finished
+		void Wait(const JobHandle& job);
+
+		// Splits [0, count) in ranges of grainSize and calls function(begin, end) for each of them on the workers and the calling thread.
+		// Returns once every range is done.
+		template<typename Function>
+		void ParallelFor(size_t count, size_t grainSize, const Function& function);
+
+		int GetWorkerCount() const { return static_cast<int>(m_Workers.size()); }
+		// Workers + the creating thread
+		int GetThreadCount() const { return GetWorkerCount() + 1; }
+		Stats GetStats() const { return { m_NrExecutedJobs.load(std::memory_order_relaxed), m_NrStolenJobs.load(std::memory_order_relaxed) }; }
+
+	private:
+		struct WorkQueue
+		{
+			std::mutex mutex{};
+			std::deque<std::shared_ptr<JobState>> pJobs{};
+		};
+
+		std::vector<std::thread> m_Workers{};
+		// [0] belongs to the creating thread, [i + 1] to worker i
+		std::vector<std::unique_ptr<WorkQueue>> m_pQueues{};
+		WorkQueue m_BackgroundQueue{};
+
+		std::atomic<int> m_NrQueuedJobs{};
+		std::atomic<int> m_NrSleepingWorkers{};
+		std::mutex m_SleepMutex{};
+		std::condition_variable m_WakeUp{};
+		bool m_IsRunning{ true };
+
+		std::atomic<uint64_t> m_NrExecutedJobs{};
+		std::atomic<uint64_t> m_NrStolenJobs{};
+
+		void Enqueue(std::shared_ptr<JobState> pJob);
+		std::shared_ptr<JobState> FindJob(int queueIdx, bool allowBackground);
+		void Execute(const std::shared_ptr<JobState>& pJob);
+		void WorkerLoop(int queueIdx);
+
+		// Deque of the calling thread, -1 for threads outside of the job system
+		int GetQueueIndex() const;
+	};
+
+	template<typename Function>
+	void JobSystem::ParallelFor(size_t count, size_t grainSize, const Function& function)
+	{
+		if (count == 0) return;
+
+		grainSize = std::max<size_t>(grainSize, 1);
+		const size_t nrRanges{ (count + grainSize - 1) / grainSize };
+		if (nrRanges == 1 || m_Workers.empty())
+		{
+			function(size_t{ 0 }, count);
+			return;
+		}
+
+		// Ranges are handed out through a shared counter instead of one job each, a slow range doesn't leave the other threads idle
+		std::atomic<size_t> nextRange{};
+		auto runRanges = [&]
+			{
+				for (size_t range{ nextRange++ }; range < nrRanges; range = nextRange++)
+				{
+					const size_t begin{ range * grainSize };
+					function(begin, std::min(count, begin + grainSize));
+				}
+			};
+
+		const size_t nrJobs{ std::min(nrRanges - 1, m_Workers.size()) };
+		std::vector<JobHandle> jobs{};
+		jobs.reserve(nrJobs);
+		for (size_t i{}; i < nrJobs; ++i)
+		{
+			jobs.push_back(Schedule(runRanges));
+		}
+
+		runRanges();
+
+		for (const JobHandle& job : jobs)
+		{
+			Wait(job);
+		}
+	}
+}
@@ -0,0 +1,139 @@
+#include "pch.h"
+#include "LightClusters.h"
+#include "Camera.h"
+#include "Profiler.h"
+
+namespace dae
+{
+	LightClusters::LightClusters(int width, int height)
+	{
+		SetResolution(width, height);
+	}
+
+	void LightClusters::SetResolution(int width, int height)
+	{
+		m_Width = width;
+		m_Height = height;
+		m_TilesX = (width + TileSize - 1) / TileSize;
+		m_TilesY = (height + TileSize - 1) / TileSize;
+
+		const size_t clusterCount{ static_cast<size_t>(m_TilesX) * m_TilesY * DepthSlices };
+		m_ClusterOffsets.resize(clusterCount);
+		m_ClusterCounts.resize(clusterCount);
+	}
+
+	void LightClusters::Build(const std::vector<LocalLight>& lights, const Camera& camera)
+	{
+		DAE_PROFILE_ZONE("Light clusters");
+		const float logNear{ log2f(camera.nearPlane) };
+		const float logFar{ log2f(camera.farPlane) };
+		m_SliceScale = DepthSlices / (logFar - logNear);
+		m_SliceBias = -logNear * m_SliceScale;
+
+		std::fill(m_ClusterCounts.begin(), m_ClusterCounts.end(), 0);
+
+		// 1. Count the lights per cluster
+		m_LightBounds.resize(lights.size());
+		for (size_t lightIdx{}; lightIdx < lights.size(); ++lightIdx)
+		{
+			ClusterBounds& bounds{ m_LightBounds[lightIdx] };
+			if (!CalculateBounds(lights[lightIdx], camera, bounds))
+			{
+				bounds.minSlice = bounds.maxSlice + 1;
+				continue;
+			}
+
+			for (int slice{ bounds.minSlice }; slice <= bounds.maxSlice; ++slice)
+				for (int tileY{ bounds.minY }; tileY <= bounds.maxY; ++tileY)
+					for (int tileX{ bounds.minX }; tileX <= bounds.maxX; ++tileX)
+						++m_ClusterCounts[GetClusterIdx(tileX, tileY, slice)];
+		}
+
+		// 2. Prefix sum into offsets
+		uint32_t totalCount{};
+		for (size_t clusterIdx{}; clusterIdx < m_ClusterCounts.size(); ++clusterIdx)
+		{
+			m_ClusterOffsets[clusterIdx] = totalCount;
+			totalCount += m_ClusterCounts[clusterIdx];
+		}
+		m_LightIndices.resize(totalCount);
+
+		// 3. Scatter the light indices
+		std::fill(m_ClusterCounts.begin(), m_ClusterCounts.end(), 0);
+		for (size_t lightIdx{}; lightIdx < lights.size(); ++lightIdx)
+		{
+			const ClusterBounds& bounds{ m_LightBounds[lightIdx] };
+			for (int slice{ bounds.minSlice }; slice <= bounds.maxSlice; ++slice)
+				for (int tileY{ bounds.minY }; tileY <= bounds.maxY; ++tileY)
+					for (int tileX{ bounds.minX }; tileX <= bounds.maxX; ++tileX)
+					{
+						const int clusterIdx{ GetClusterIdx(tileX, tileY, slice) };
+						m_LightIndices[m_ClusterOffsets[clusterIdx] + m_ClusterCounts[clusterIdx]++] = static_cast<uint32_t>(lightIdx);
+					}
+		}
+	}
+
+	LightClusters::LightRange LightClusters::GetLights(int px, int py, float viewDepth) const
+	{
+		const int tileX{ Clamp(px / TileSize, 0, m_TilesX - 1) };
+		const int tileY{ Clamp(py / TileSize, 0, m_TilesY - 1) };
+		const int clusterIdx{ GetClusterIdx(tileX, tileY, GetSlice(viewDepth)) };
+
+		return { m_LightIndices.data() + m_ClusterOffsets[clusterIdx], m_ClusterCounts[clusterIdx] };
+	}
+
+	int LightClusters::GetSlice(float viewDepth) const
+	{
+		return Clamp(static_cast<int>(FastLog2(std::max(viewDepth, FLT_MIN)) * m_SliceScale + m_SliceBias), 0, DepthSlices - 1);
+	}
+
+	bool LightClusters::CalculateBounds(const LocalLight& light, const Camera& camera, ClusterBounds& bounds) const
+	{
+		// Bounding sphere in view space
+		const Vector3 center{ camera.GetViewMatrix().TransformPoint(light.position) };
+		const float radius{ light.range };
+
+		const float minZ{ center.z - radius };
+		const float maxZ{ center.z + radius };
+		if (maxZ < camera.nearPlane || minZ > camera.farPlane) return false;
+
+		bounds.minSlice = GetSlice(std::max(minZ, camera.nearPlane));
+		bounds.maxSlice = GetSlice(maxZ);
+
+		if (minZ <= camera.nearPlane)
+		{
+			// Camera is inside or right in front of the sphere
+			bounds.minX = 0;
+			bounds.minY = 0;
+			bounds.maxX = m_TilesX - 1;
+			bounds.maxY = m_TilesY - 1;
+			return true;
+		}
+
+		// x / z is largest at the closest depth for positive x and at the furthest depth for negative x, same for y
+		const float scaleX{ 1.f / (camera.aspectRatio * camera.fov) };
+		const float scaleY{ 1.f / camera.fov };
+		auto project = [minZ, maxZ](float v, bool isMax)
+			{
+				return (v > 0.f) == isMax ? v / minZ : v / maxZ;
+			};
+
+		const float ndcMinX{ project(center.x - radius, false) * scaleX };
+		const float ndcMaxX{ project(center.x + radius, true) * scaleX };
+		const float ndcMinY{ project(center.y - radius, false) * scaleY };
+		const float ndcMaxY{ project(center.y + radius, true) * scaleY };
+		if (ndcMaxX < -1.f || ndcMinX > 1.f || ndcMaxY < -1.f || ndcMinY > 1.f) return false;
+
+		// NDC --> Screenspace, y is flipped
+		const float screenMinX{ (ndcMinX + 1) / 2.0f * m_Width };
+		const float screenMaxX{ (ndcMaxX + 1) / 2.0f * m_Width };
+		const float screenMinY{ (1.0f - ndcMaxY) / 2.0f * m_Height };
+		const float screenMaxY{ (1.0f - ndcMinY) / 2.0f * m_Height };
+
+		bounds.minX = Clamp(static_cast<int>(screenMinX) / TileSize, 0, m_TilesX - 1);
+		bounds.maxX = Clamp(static_cast<int>(screenMaxX) / TileSize, 0, m_TilesX - 1);
+		bounds.minY = Clamp(static_cast<int>(screenMinY) / TileSize, 0, m_TilesY - 1);
+		bounds.maxY = Clamp(static_cast<int>(screenMaxY) / TileSize, 0, m_TilesY - 1);
+		return true;
+	}
+}
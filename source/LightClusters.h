@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include "DataTypes.h"
+
+namespace dae
+{
+	struct Camera;
+
+	// Assigns local lights to screen tile x depth slice clusters once per frame,
+	// so a pixel only has to iterate the lights that can reach its cluster.
+	class LightClusters final
+	{
+	public:
+		LightClusters(int width, int height);
+		~LightClusters() = default;
+
+		LightClusters(const LightClusters& other) = delete;
+		LightClusters& operator=(const LightClusters& other) = delete;
+		LightClusters(LightClusters&& other) = delete;
+		LightClusters& operator=(LightClusters&& other) = delete;
+
+		struct LightRange
+		{
+			const uint32_t* pLightIndices{};
+			uint32_t count{};
+		};
+
+		// Screen size in pixels, the renderer changes it with its internal resolution
+		void SetResolution(int width, int height);
+
+		void Build(const std::vector<LocalLight>& lights, const Camera& camera);
+
+		// viewDepth is the view space z of the pixel
+		LightRange GetLights(int px, int py, float viewDepth) const;
+
+		static constexpr int TileSize{ 32 };
+		static constexpr int DepthSlices{ 16 };
+
+	private:
+		int m_Width{};
+		int m_Height{};
+		int m_TilesX{};
+		int m_TilesY{};
+
+		// Exponential depth slices: slice = log2(z) * scale + bias
+		float m_SliceScale{};
+		float m_SliceBias{};
+
+		std::vector<uint32_t> m_ClusterOffsets{};
+		std::vector<uint32_t> m_ClusterCounts{};
+		std::vector<uint32_t> m_LightIndices{};
+
+		struct ClusterBounds
+		{
+			int minX{}, maxX{};
+			int minY{}, maxY{};
+			int minSlice{}, maxSlice{};
+		};
+		std::vector<ClusterBounds> m_LightBounds{};
+
+		int GetClusterIdx(int tileX, int tileY, int slice) const { return tileX + m_TilesX * (tileY + m_TilesY * slice); }
+		int GetSlice(float viewDepth) const;
+		bool CalculateBounds(const LocalLight& light, const Camera& camera, ClusterBounds& bounds) const;
+	};
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include <cstddef>
+#include "Vector3.h"
+#include "Vector4.h"
+#include "SIMD.h"
+
+// AVX is only there when the compiler targets it (/arch:AVX or -mavx), SSE is the baseline on x64
+#if defined(DAE_SIMD_SSE) && defined(__AVX__)
+#define DAE_SIMD_AVX 1
+#endif
+
+namespace dae
+{
+	// Implementations behind Matrix, on the 4 rows of a row-major matrix (row vectors, p' = p * M).
+	// Scalar is the portable reference, SSE is picked as Active when available.
+	// Both stay callable so the benchmarks can compare them in one build.
+	namespace MathBackend
+	{
+		namespace Scalar
+		{
+			inline void Multiply(const Vector4* pA, const Vector4* pB, Vector4* pOut)
+			{
+				for (int r{ 0 }; r < 4; ++r)
+				{
+					const Vector4 row{ pA[r] };
+					pOut[r] = {
+						row.x * pB[0].x + row.y * pB[1].x + row.z * pB[2].x + row.w * pB[3].x,
+						row.x * pB[0].y + row.y * pB[1].y + row.z * pB[2].y + row.w * pB[3].y,
+						row.x * pB[0].z + row.y * pB[1].z + row.z * pB[2].z + row.w * pB[3].z,
+						row.x * pB[0].w + row.y * pB[1].w + row.z * pB[2].w + row.w * pB[3].w
+					};
+				}
+			}
+
+			inline Vector4 TransformPoint(const Vector4* pRows, float x, float y, float z, float w)
+			{
+				return Vector4{
+					pRows[0].x * x + pRows[1].x * y + pRows[2].x * z + pRows[3].x * w,
+					pRows[0].y * x + pRows[1].y * y + pRows[2].y * z + pRows[3].y * w,
+					pRows[0].z * x + pRows[1].z * y + pRows[2].z * z + pRows[3].z * w,
+					pRows[0].w * x + pRows[1].w * y + pRows[2].w * z + pRows[3].w * w
+				};
+			}
+
+			// w = 1
+			inline void TransformPoints(const Vector4* pRows, const Vector3* pIn, Vector4* pOut, size_t count)
+			{
+				for (size_t i{}; i < count; ++i)
+				{
+					pOut[i] = TransformPoint(pRows, pIn[i].x, pIn[i].y, pIn[i].z, 1.f);
+				}
+			}
+
+			// w = 1, projective part dropped
+			inline void TransformPoints(const Vector4* pRows, const Vector3* pIn, Vector3* pOut, size_t count)
+			{
+				for (size_t i{}; i < count; ++i)
+				{
+					const Vector4 p{ TransformPoint(pRows, pIn[i].x, pIn[i].y, pIn[i].z, 1.f) };
+					pOut[i] = { p.x, p.y, p.z };
+				}
+			}
+
+			// w = 0
+			inline void TransformVectors(const Vector4* pRows, const Vector3* pIn, Vector3* pOut, size_t count)
+			{
+				for (size_t i{}; i < count; ++i)
+				{
+					const Vector4 v{ TransformPoint(pRows, pIn[i].x, pIn[i].y, pIn[i].z, 0.f) };
+					pOut[i] = { v.x, v.y, v.z };
+				}
+			}
+		}
+
+#if defined(DAE_SIMD_SSE)
+		namespace SSE
+		{
+			struct Rows
+			{
+				__m128 r0, r1, r2, r3;
+			};
+
+			inline Rows Load(const Vector4* pRows)
+			{
+				return { _mm_loadu_ps(&pRows[0].x), _mm_loadu_ps(&pRows[1].x), _mm_loadu_ps(&pRows[2].x), _mm_loadu_ps(&pRows[3].x) };
+			}
+
+			inline __m128 TransformPoint(const Rows& rows, __m128 x, __m128 y, __m128 z)
+			{
+				return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, rows.r0), _mm_mul_ps(y, rows.r1)), _mm_add_ps(_mm_mul_ps(z, rows.r2), rows.r3));
+			}
+
+			inline __m128 TransformVector(const Rows& rows, __m128 x, __m128 y, __m128 z)
+			{
+				return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, rows.r0), _mm_mul_ps(y, rows.r1)), _mm_mul_ps(z, rows.r2));
+			}
+
+			inline __m128 TransformPoint(const Rows& rows, __m128 x, __m128 y, __m128 z, __m128 w)
+			{
+				return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, rows.r0), _mm_mul_ps(y, rows.r1)), _mm_add_ps(_mm_mul_ps(z, rows.r2), _mm_mul_ps(w, rows.r3)));
+			}
+
+			// Every output row is a linear combination of the rows of B, no transpose needed
+			inline void Multiply(const Vector4* pA, const Vector4* pB, Vector4* pOut)
+			{
+				const Rows b{ Load(pB) };
+				__m128 result[4];
+				for (int r{ 0 }; r < 4; ++r)
+				{
+					result[r] = TransformPoint(b, _mm_set1_ps(pA[r].x), _mm_set1_ps(pA[r].y), _mm_set1_ps(pA[r].z), _mm_set1_ps(pA[r].w));
+				}
+				// pOut may alias pA
+				for (int r{ 0 }; r < 4; ++r) _mm_storeu_ps(&pOut[r].x, result[r]);
+			}
+
+			inline Vector4 TransformPoint(const Vector4* pRows, float x, float y, float z, float w)
+			{
+				Vector4 result;
+				_mm_storeu_ps(&result.x, TransformPoint(Load(pRows), _mm_set1_ps(x), _mm_set1_ps(y), _mm_set1_ps(z), _mm_set1_ps(w)));
+				return result;
+			}
+
+			inline void TransformPoints(const Vector4* pRows, const Vector3* pIn, Vector4* pOut, size_t count)
+			{
+				const Rows rows{ Load(pRows) };
+				size_t i{};
+#if defined(DAE_SIMD_AVX)
+				// Two points per iteration, one per 128 bit half
+				const __m256 r0{ _mm256_broadcast_ps(&rows.r0) };
+				const __m256 r1{ _mm256_broadcast_ps(&rows.r1) };
+				const __m256 r2{ _mm256_broadcast_ps(&rows.r2) };
+				const __m256 r3{ _mm256_broadcast_ps(&rows.r3) };
+				for (; i + 1 < count; i += 2)
+				{
+					const __m256 x{ _mm256_set_m128(_mm_set1_ps(pIn[i + 1].x), _mm_set1_ps(pIn[i].x)) };
+					const __m256 y{ _mm256_set_m128(_mm_set1_ps(pIn[i + 1].y), _mm_set1_ps(pIn[i].y)) };
+					const __m256 z{ _mm256_set_m128(_mm_set1_ps(pIn[i + 1].z), _mm_set1_ps(pIn[i].z)) };
+					const __m256 p{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, r0), _mm256_mul_ps(y, r1)), _mm256_add_ps(_mm256_mul_ps(z, r2), r3)) };
+					_mm256_storeu_ps(&pOut[i].x, p);
+				}
+#endif
+				for (; i < count; ++i)
+				{
+					_mm_storeu_ps(&pOut[i].x, TransformPoint(rows, _mm_set1_ps(pIn[i].x), _mm_set1_ps(pIn[i].y), _mm_set1_ps(pIn[i].z)));
+				}
+			}
+
+			inline void TransformPoints(const Vector4* pRows, const Vector3* pIn, Vector3* pOut, size_t count)
+			{
+				const Rows rows{ Load(pRows) };
+				for (size_t i{}; i < count; ++i)
+				{
+					alignas(16) float p[4];
+					_mm_store_ps(p, TransformPoint(rows, _mm_set1_ps(pIn[i].x), _mm_set1_ps(pIn[i].y), _mm_set1_ps(pIn[i].z)));
+					pOut[i] = { p[0], p[1], p[2] };
+				}
+			}
+
+			inline void TransformVectors(const Vector4* pRows, const Vector3* pIn, Vector3* pOut, size_t count)
+			{
+				const Rows rows{ Load(pRows) };
+				for (size_t i{}; i < count; ++i)
+				{
+					alignas(16) float v[4];
+					_mm_store_ps(v, TransformVector(rows, _mm_set1_ps(pIn[i].x), _mm_set1_ps(pIn[i].y), _mm_set1_ps(pIn[i].z)));
+					pOut[i] = { v[0], v[1], v[2] };
+				}
+			}
+		}
+
+		namespace Active = SSE;
+#else
+		namespace Active = Scalar;
+#endif
+	}
+}
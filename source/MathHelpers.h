@@ -1,5 +1,7 @@
 #pragma once
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 
 namespace dae
 {
@@ -56,4 +58,41 @@ namespace dae
 		if (v > 1.f) return 1.f;
 		return v;
 	}
+
+	/* --- FAST APPROXIMATIONS --- */
+	// log2 with a degree 5 polynomial on the mantissa, max absolute error 1e-5 near 1 and 1.3e-5 over all normal floats (the float rounding of the exponent adds to it)
+	inline float FastLog2(float x)
+	{
+		uint32_t bits{};
+		std::memcpy(&bits, &x, sizeof(float));
+		const float exponent{ static_cast<float>(static_cast<int>((bits >> 23) & 0xFF) - 127) };
+		bits = (bits & 0x007FFFFF) | 0x3F800000;
+		float m{};
+		std::memcpy(&m, &bits, sizeof(float));
+
+		const float p{ ((((-3.4436006e-2f * m + 3.1821337e-1f) * m - 1.2315303f) * m + 2.5988452f) * m - 3.3241990f) * m + 3.1157899f };
+		return p * (m - 1.f) + exponent;
+	}
+
+	// exp2 with a degree 5 polynomial on the fraction, max relative error 2e-7
+	inline float FastExp2(float y)
+	{
+		y = Clamp(y, -126.f, 127.f);
+		const float floorY{ floorf(y) };
+		const float f{ y - floorY };
+
+		const uint32_t bits{ static_cast<uint32_t>(static_cast<int>(floorY) + 127) << 23 };
+		float scale{};
+		std::memcpy(&scale, &bits, sizeof(float));
+
+		const float p{ ((((1.8775767e-3f * f + 8.9893397e-3f) * f + 5.5826318e-2f) * f + 2.4015361e-1f) * f + 6.9315308e-1f) * f + 9.9999994e-1f };
+		return scale * p;
+	}
+
+	// powf for base in (0, 1] and exponent in [0, 25] (the specular range):
+	// max absolute error 1.5e-4, max relative error 1.7e-4, far below the 1/255 of the output
+	inline float FastPow(float base, float exponent)
+	{
+		return FastExp2(exponent * FastLog2(base));
+	}
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <cassert>
 
 #include "MathHelpers.h"
+#include "MathBackend.h"
 #include <cmath>
 
 namespace dae {
@@ -36,11 +37,7 @@ namespace dae {
 
 	Vector3 Matrix::TransformVector(float x, float y, float z) const
 	{
-		return Vector3{
-			data[0].x * x + data[1].x * y + data[2].x * z,
-			data[0].y * x + data[1].y * y + data[2].y * z,
-			data[0].z * x + data[1].z * y + data[2].z * z
-		};
+		return MathBackend::Active::TransformPoint(data, x, y, z, 0.f).GetXYZ();
 	}
 
 	Vector3 Matrix::TransformPoint(const Vector3& p) const
@@ -50,11 +47,7 @@ namespace dae {
 
 	Vector3 Matrix::TransformPoint(float x, float y, float z) const
 	{
-		return Vector3{
-			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
-			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
-			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
-		};
+		return MathBackend::Active::TransformPoint(data, x, y, z, 1.f).GetXYZ();
 	}
 
 	Vector4 Matrix::TransformPoint(const Vector4& p) const
@@ -64,12 +57,25 @@ namespace dae {
 
 	Vector4 Matrix::TransformPoint(float x, float y, float z, float w) const
 	{
-		return Vector4{
-			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
-			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
-			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
-			data[0].w * x + data[1].w * y + data[2].w * z + data[3].w
-		};
+		return MathBackend::Active::TransformPoint(data, x, y, z, w);
+	}
+
+	void Matrix::TransformPoints(std::span<const Vector3> points, std::span<Vector4> out) const
+	{
+		assert(out.size() >= points.size());
+		MathBackend::Active::TransformPoints(data, points.data(), out.data(), points.size());
+	}
+
+	void Matrix::TransformPoints(std::span<const Vector3> points, std::span<Vector3> out) const
+	{
+		assert(out.size() >= points.size());
+		MathBackend::Active::TransformPoints(data, points.data(), out.data(), points.size());
+	}
+
+	void Matrix::TransformVectors(std::span<const Vector3> vectors, std::span<Vector3> out) const
+	{
+		assert(out.size() >= vectors.size());
+		MathBackend::Active::TransformVectors(data, vectors.data(), out.data(), vectors.size());
 	}
 
 	const Matrix& Matrix::Transpose()
@@ -257,31 +263,15 @@ namespace dae {
 	Matrix Matrix::operator*(const Matrix& m) const
 	{
 		Matrix result{};
-		Matrix m_transposed = Transpose(m);
-
-		for (int r{ 0 }; r < 4; ++r)
-		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
-			}
-		}
+		MathBackend::Active::Multiply(data, m.data, result.data);
 
 		return result;
 	}
 
 	const Matrix& Matrix::operator*=(const Matrix& m)
 	{
-		Matrix copy{ *this };
-		Matrix m_transposed = Transpose(m);
-
-		for (int r{ 0 }; r < 4; ++r)
-		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				data[r][c] = Vector4::Dot(copy[r], m_transposed[c]);
-			}
-		}
+		// m can be *this
+		*this = *this * m;
 
 		return *this;
 	}
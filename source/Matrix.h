@@ -1,4 +1,5 @@
 #pragma once
+#include <span>
 #include "Vector3.h"
 #include "Vector4.h"
 
@@ -28,6 +29,11 @@ namespace dae {
 		Vector4 TransformPoint(const Vector4& p) const;
 		Vector4 TransformPoint(float x, float y, float z, float w) const;
 
+		// Batch versions (w = 1 for points, 0 for vectors), out needs at least as many elements as the input
+		void TransformPoints(std::span<const Vector3> points, std::span<Vector4> out) const;
+		void TransformPoints(std::span<const Vector3> points, std::span<Vector3> out) const;
+		void TransformVectors(std::span<const Vector3> vectors, std::span<Vector3> out) const;
+
 		const Matrix& Transpose();
 		const Matrix& Inverse();
 
@@ -35,6 +41,7 @@ namespace dae {
 		Vector3 GetAxisY() const;
 		Vector3 GetAxisZ() const;
 		Vector3 GetTranslation() const;
+		const Vector4* GetRows() const { return data; }
 
 		static Matrix CreateTranslation(float x, float y, float z);
 		static Matrix CreateTranslation(const Vector3& t);
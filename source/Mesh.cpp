@@ -2,12 +2,14 @@
 #include "Mesh.h"
 #include "Effect.h"
 #include "Utils.h"
+#include "Profiler.h"
 
 #include "HelperFuncts.h"
 
 dae::Mesh::Mesh(ID3D11Device* pDevice, const std::string& objFilePath, std::unique_ptr<Effect> pEffect)
 	:m_pEffect{ std::move(pEffect) }
 {
+	DAE_PROFILE_ZONE("Load mesh");
 	if (!Utils::ParseOBJ(objFilePath, vertices, indices))
 	{
 		std::cout << "Invalid filepath!\n";
@@ -118,11 +120,11 @@ void dae::Mesh::Render(ID3D11DeviceContext* pDeviceContext) const
 	}
 }
 
-void dae::Mesh::UpdateViewMatrices(const Matrix& viewProjectionMatrix, const Matrix& inverseViewMatrix)
+void dae::Mesh::UpdateViewMatrices(const AffineTransform& worldMatrix, const Matrix& viewProjectionMatrix, const AffineTransform& inverseViewMatrix)
 {
 	m_pEffect->SetWorldViewProjectionMatrix(worldMatrix * viewProjectionMatrix);
-	m_pEffect->SetInverseViewMatrix(inverseViewMatrix);
-	m_pEffect->SetWorldMatrix(worldMatrix);
+	m_pEffect->SetInverseViewMatrix(inverseViewMatrix.ToMatrix());
+	m_pEffect->SetWorldMatrix(worldMatrix.ToMatrix());
 }
 
 void dae::Mesh::SetFilteringMethod(Effect::FilteringMethod filteringMethod)
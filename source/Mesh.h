@@ -20,21 +20,28 @@ namespace dae
 
 		std::vector<Vertex_Out> vertices_out{};
 
-		Matrix worldMatrix;
-
+		// Rotations are applied in local space, on top of the current rotation.
+		// The quaternion is renormalized every time so it can't drift, however long it keeps spinning.
 		inline void RotateX(float angle)
 		{
-			worldMatrix = Matrix::CreateRotationX(angle) * worldMatrix;
+			// Same direction as Matrix::CreateRotationX
+			Rotate(Quaternion::CreateFromAxisAngle(Vector3::UnitX, -angle));
 		}
 
 		inline void RotateY(float angle)
 		{
-			worldMatrix = Matrix::CreateRotationY(angle) * worldMatrix;
+			Rotate(Quaternion::CreateFromAxisAngle(Vector3::UnitY, angle));
 		}
 
 		inline void RotateZ(float angle)
 		{
-			worldMatrix = Matrix::CreateRotationZ(angle) * worldMatrix;
+			Rotate(Quaternion::CreateFromAxisAngle(Vector3::UnitZ, angle));
+		}
+
+		inline void Rotate(const Quaternion& rotation)
+		{
+			m_Rotation = (m_Rotation * rotation).Normalized();
+			UpdateWorldMatrix();
 		}
 
 		inline void Translate(const Vector3& v)
@@ -42,10 +49,35 @@ namespace dae
 			Translate(v.x, v.y, v.z);
 		}
 
+		// Moves along the local (rotated and scaled) axes
 		inline void Translate(float x, float y, float z)
 		{
-			worldMatrix = Matrix::CreateTranslation(x, y, z) * worldMatrix;
+			m_Position += m_Rotation.Rotate({ x * m_Scale.x, y * m_Scale.y, z * m_Scale.z });
+			UpdateWorldMatrix();
+		}
+
+		inline void SetTransform(const Vector3& position, const Quaternion& rotation, const Vector3& scale)
+		{
+			m_Position = position;
+			m_Rotation = rotation;
+			m_Scale = scale;
+			UpdateWorldMatrix();
 		}
+
+		const Vector3& GetPosition() const { return m_Position; }
+		const Quaternion& GetRotation() const { return m_Rotation; }
+		const Vector3& GetScale() const { return m_Scale; }
+
+		// Rebuilt by the calls above, so the const getter never writes and the render jobs can share it
+		const AffineTransform& GetWorldMatrix() const { return m_WorldMatrix; }
+
+	private:
+		Vector3 m_Position{};
+		Quaternion m_Rotation{};
+		Vector3 m_Scale{ 1.f, 1.f, 1.f };
+		AffineTransform m_WorldMatrix{};
+
+		void UpdateWorldMatrix() { m_WorldMatrix = AffineTransform::CreateTRS(m_Position, m_Rotation, m_Scale); }
 	};
 
 	class Mesh final : public UntexturedMesh
@@ -62,7 +94,8 @@ namespace dae
 		// Hardware
 		void Render(ID3D11DeviceContext* pDeviceContext) const;
 
-		void UpdateViewMatrices(const Matrix& viewProjectionMatrix, const Matrix& inverseViewMatrix);
+		// The world matrix is passed in, the frame can show a different transform than the mesh currently has
+		void UpdateViewMatrices(const AffineTransform& worldMatrix, const Matrix& viewProjectionMatrix, const AffineTransform& inverseViewMatrix);
 
 		void SetFilteringMethod(Effect::FilteringMethod filteringMethod);
 
@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "Presenter.h"
+#include "Profiler.h"
+
+namespace dae
+{
+	Presenter::Presenter(SDL_Window* pWindow, int width, int height)
+		:m_pWindow{ pWindow }
+		,m_pFrontBuffer{ SDL_GetWindowSurface(pWindow) }
+	{
+		const SDL_PixelFormat* pWindowFormat{ m_pFrontBuffer->format };
+		m_CanRenderDirectly = pWindowFormat->BytesPerPixel == 4
+			&& pWindowFormat->Rloss == 0 && pWindowFormat->Gloss == 0 && pWindowFormat->Bloss == 0
+			&& m_pFrontBuffer->pitch == width * 4;
+
+		// Same layout as the window, unless the window isn't 32 bit. Then the blit has to convert anyway.
+		for (int i{}; i < m_NrBuffers; ++i)
+		{
+			m_pBuffers.push_back(pWindowFormat->BytesPerPixel == 4
+				? SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, pWindowFormat->format)
+				: SDL_CreateRGBSurface(0, width, height, 32, 0, 0, 0, 0));
+		}
+		m_pFreeBuffers = m_pBuffers;
+
+		m_PresentThread = std::thread{ [this] { PresentLoop(); } };
+	}
+
+	Presenter::~Presenter()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsRunning = false;
+		}
+		m_FrameSubmitted.notify_one();
+		m_PresentThread.join();
+
+		for (SDL_Surface* pBuffer : m_pBuffers)
+		{
+			SDL_FreeSurface(pBuffer);
+		}
+	}
+
+	SDL_Surface* Presenter::AcquireBuffer()
+	{
+		DAE_PROFILE_ZONE("Acquire buffer");
+		const Clock::time_point startTime{ Clock::now() };
+
+		std::unique_lock lock{ m_Mutex };
+		SDL_Surface* pBuffer{};
+		if (m_LatencyMode == LatencyMode::ZeroCopy)
+		{
+			// The window surface can only be written once the previous frame is on screen
+			m_BufferFreed.wait(lock, [this] { return m_Queue.empty() && !m_IsPresenting; });
+			pBuffer = m_pFrontBuffer;
+		}
+		else
+		{
+			m_BufferFreed.wait(lock, [this] { return !m_pFreeBuffers.empty(); });
+			pBuffer = m_pFreeBuffers.back();
+			m_pFreeBuffers.pop_back();
+		}
+
+		constexpr float smoothing{ 0.1f };
+		const float waitMs{ std::chrono::duration<float, std::milli>(Clock::now() - startTime).count() };
+		m_Stats.acquireWaitMs = Lerpf(m_Stats.acquireWaitMs, waitMs, smoothing);
+		return pBuffer;
+	}
+
+	void Presenter::Submit(SDL_Surface* pBuffer, Clock::time_point updateTime)
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			if (m_LatencyMode == LatencyMode::LowLatency)
+			{
+				// Frames that are still waiting are older than this one, they'd only add latency
+				for (const Frame& frame : m_Queue)
+				{
+					if (frame.pBuffer != m_pFrontBuffer) m_pFreeBuffers.push_back(frame.pBuffer);
+					++m_Stats.droppedFrames;
+				}
+				m_Queue.clear();
+				m_BufferFreed.notify_all();
+			}
+			m_Queue.push_back({ pBuffer, updateTime });
+		}
+		m_FrameSubmitted.notify_one();
+	}
+
+	void Presenter::Flush()
+	{
+		std::unique_lock lock{ m_Mutex };
+		m_BufferFreed.wait(lock, [this] { return m_Queue.empty() && !m_IsPresenting; });
+	}
+
+	void Presenter::SetLatencyMode(LatencyMode latencyMode)
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_LatencyMode = (latencyMode == LatencyMode::ZeroCopy && !m_CanRenderDirectly) ? LatencyMode::Throughput : latencyMode;
+	}
+
+	Presenter::LatencyMode Presenter::GetLatencyMode() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_LatencyMode;
+	}
+
+	Presenter::Stats Presenter::GetStats() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_Stats;
+	}
+
+	const char* Presenter::GetPixelFormatName() const
+	{
+		return SDL_GetPixelFormatName(m_pFrontBuffer->format->format);
+	}
+
+	void Presenter::PresentLoop()
+	{
+		while (true)
+		{
+			Frame frame{};
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_FrameSubmitted.wait(lock, [this] { return !m_IsRunning || !m_Queue.empty(); });
+				if (!m_IsRunning) return;
+
+				frame = m_Queue.front();
+				m_Queue.pop_front();
+				m_IsPresenting = true;
+			}
+
+			// Outside of the lock, the renderer can acquire and submit in the meantime.
+			// Not the window's thread, see the class comment for why the blit and the window update are fine here.
+			const bool isZeroCopy{ frame.pBuffer == m_pFrontBuffer };
+			{
+				DAE_PROFILE_ZONE("Present");
+				if (!isZeroCopy)
+				{
+					SDL_BlitSurface(frame.pBuffer, 0, m_pFrontBuffer, 0);
+				}
+				SDL_UpdateWindowSurface(m_pWindow);
+			}
+
+			{
+				std::lock_guard lock{ m_Mutex };
+				m_IsPresenting = false;
+				if (!isZeroCopy)
+				{
+					m_pFreeBuffers.push_back(frame.pBuffer);
+				}
+
+				constexpr float smoothing{ 0.1f };
+				const float latencyMs{ std::chrono::duration<float, std::milli>(Clock::now() - frame.updateTime).count() };
+				m_Stats.latencyMs = Lerpf(m_Stats.latencyMs, latencyMs, smoothing);
+				++m_Stats.presentedFrames;
+			}
+			// Flush waits on the same condition
+			m_BufferFreed.notify_all();
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+struct SDL_Window;
+struct SDL_Surface;
+
+namespace dae
+{
+	// Presents the software frames on its own thread, from a ring of back buffers.
+	// The renderer acquires a free buffer, renders into it and submits it, the blit into the window surface
+	// and the window update happen while the renderer is already working on the next frame.
+	// The back buffers use the pixel format of the window surface, so the blit is a plain copy instead of a conversion.
+	// That copy is cheap next to the window update, so Throughput is the default. ZeroCopy skips it, but gives up the overlap.
+	//
+	// The window belongs to the input thread, the window surface is created on the frame thread and updated on the present thread.
+	// SDL only promises that for the window-owning thread, it holds here because this renderer is Windows only:
+	// - SDL_UpdateWindowSurface is a GDI BitBlt from the surface's DIB section into the window DC. GDI calls aren't bound to
+	//   the thread that owns the window, only window messages are, and it sends none.
+	// - Only the present thread uses that DC while software frames are queued, Flush runs before the hardware renderer takes over.
+	// - A resize would recreate the surface on the event thread, the window is created without SDL_WINDOW_RESIZABLE.
+	// Any other window or video call still has to stay on the input thread.
+	class Presenter final
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		enum class LatencyMode
+		{
+			ZeroCopy,	// opt-in, renders straight into the window surface, no back buffer and no blit, the renderer waits for the previous window update
+			Throughput,	// every frame is presented in order, the renderer only waits when all buffers are in flight
+			LowLatency,	// a newer frame replaces the one still waiting, the renderer never waits
+			END
+		};
+
+		struct Stats
+		{
+			uint64_t presentedFrames{};
+			uint64_t droppedFrames{};
+			float acquireWaitMs{};	// renderer blocked on a free buffer, smoothed
+			float latencyMs{};		// update -> on screen, smoothed
+		};
+
+		Presenter(SDL_Window* pWindow, int width, int height);
+		~Presenter();
+
+		Presenter(const Presenter& other) = delete;
+		Presenter& operator=(const Presenter& other) = delete;
+		Presenter(Presenter&& other) = delete;
+		Presenter& operator=(Presenter&& other) = delete;
+
+		// Throughput blocks only when every buffer is queued or being presented, LowLatency never does.
+		// ZeroCopy hands out the window surface, so it blocks until every submitted frame is on screen.
+		SDL_Surface* AcquireBuffer();
+		// Hands the buffer to the present thread and returns right away, updateTime is when the frame's state was captured
+		void Submit(SDL_Surface* pBuffer, Clock::time_point updateTime);
+		// Waits until everything that was submitted is on screen, so another renderer can take over the window
+		void Flush();
+
+		// Falls back to Throughput when the window surface can't be rendered into directly
+		void SetLatencyMode(LatencyMode latencyMode);
+		LatencyMode GetLatencyMode() const;
+		Stats GetStats() const;
+		const char* GetPixelFormatName() const;
+		// 32 bit, 8 bits per channel and no row padding, the layout the rasterizer writes
+		bool CanRenderDirectly() const { return m_CanRenderDirectly; }
+
+	private:
+		struct Frame
+		{
+			SDL_Surface* pBuffer{};
+			Clock::time_point updateTime{};
+		};
+
+		static constexpr int m_NrBuffers{ 3 };
+
+		SDL_Window* m_pWindow{};
+		SDL_Surface* m_pFrontBuffer{};
+		std::vector<SDL_Surface*> m_pBuffers{};
+		bool m_CanRenderDirectly{ false };
+
+		std::thread m_PresentThread{};
+		mutable std::mutex m_Mutex{};
+		std::condition_variable m_BufferFreed{};
+		std::condition_variable m_FrameSubmitted{};
+		std::vector<SDL_Surface*> m_pFreeBuffers{};
+		std::deque<Frame> m_Queue{};
+		bool m_IsPresenting{ false };
+		bool m_IsRunning{ true };
+		LatencyMode m_LatencyMode{ LatencyMode::Throughput };
+		Stats m_Stats{};
+
+		void PresentLoop();
+	};
+}
@@ -0,0 +1,130 @@
+#include "pch.h"
+#include "Profiler.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string_view>
+
+namespace dae
+{
+	namespace Profiler
+	{
+		namespace
+		{
+			// Distinct zones per thread, a few dozen at most
+			constexpr int g_MaxZones{ 64 };
+
+			struct Zone
+			{
+				// Written by the owning thread, read by CollectStats
+				std::atomic<uint64_t> nanoseconds{};
+				std::atomic<uint64_t> calls{};
+				const char* name{};
+
+				// Totals at the previous CollectStats, only touched under g_Mutex
+				uint64_t reportedNanoseconds{};
+				uint64_t reportedCalls{};
+			};
+
+			// Own cache lines, so threads never write next to each other
+			struct alignas(64) ThreadZones
+			{
+				std::array<Zone, g_MaxZones> zones{};
+				// A zone's name is set before it is published here
+				std::atomic<int> nrZones{};
+			};
+
+			// Kept until the program ends, the counters of a finished thread are still reported
+			std::mutex g_Mutex{};
+			std::vector<std::unique_ptr<ThreadZones>> g_pThreads{};
+			std::atomic<uint64_t> g_NrFrames{};
+			uint64_t g_NrReportedFrames{};
+
+			thread_local ThreadZones* t_pZones{ nullptr };
+
+			ThreadZones& GetThreadZones()
+			{
+				if (!t_pZones)
+				{
+					std::lock_guard lock{ g_Mutex };
+					g_pThreads.push_back(std::make_unique<ThreadZones>());
+					t_pZones = g_pThreads.back().get();
+				}
+				return *t_pZones;
+			}
+		}
+
+		void AddSample(const char* name, uint64_t nanoseconds)
+		{
+			ThreadZones& thread{ GetThreadZones() };
+
+			// Only this thread adds zones, so the count can't change underneath
+			const int nrZones{ thread.nrZones.load(std::memory_order_relaxed) };
+			int zoneIdx{};
+			while (zoneIdx < nrZones && thread.zones[zoneIdx].name != name)
+			{
+				++zoneIdx;
+			}
+
+			if (zoneIdx == nrZones)
+			{
+				if (nrZones == g_MaxZones) return;
+
+				thread.zones[zoneIdx].name = name;
+				thread.nrZones.store(nrZones + 1, std::memory_order_release);
+			}
+
+			// Single writer, a plain add is enough, the atomics only keep the reads in CollectStats defined
+			Zone& zone{ thread.zones[zoneIdx] };
+			zone.nanoseconds.store(zone.nanoseconds.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+			zone.calls.store(zone.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		void EndFrame()
+		{
+			g_NrFrames.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		std::vector<StageStats> CollectStats()
+		{
+			std::lock_guard lock{ g_Mutex };
+
+			const uint64_t nrFrames{ g_NrFrames.load(std::memory_order_relaxed) };
+			const float invFrames{ 1.f / std::max<uint64_t>(nrFrames - g_NrReportedFrames, 1) };
+			g_NrReportedFrames = nrFrames;
+
+			// The same stage can be a different literal in another translation unit, so they are matched by name
+			std::vector<StageStats> stages{};
+			for (const std::unique_ptr<ThreadZones>& pThread : g_pThreads)
+			{
+				const int nrZones{ pThread->nrZones.load(std::memory_order_acquire) };
+				for (int zoneIdx{}; zoneIdx < nrZones; ++zoneIdx)
+				{
+					Zone& zone{ pThread->zones[zoneIdx] };
+					const uint64_t nanoseconds{ zone.nanoseconds.load(std::memory_order_relaxed) };
+					const uint64_t calls{ zone.calls.load(std::memory_order_relaxed) };
+					const uint64_t newCalls{ calls - zone.reportedCalls };
+					const float ms{ (nanoseconds - zone.reportedNanoseconds) * 1e-6f * invFrames };
+					zone.reportedNanoseconds = nanoseconds;
+					zone.reportedCalls = calls;
+					// Not entered since the last report
+					if (newCalls == 0) continue;
+
+					auto stageIt{ std::find_if(stages.begin(), stages.end(), [&zone](const StageStats& stage) { return std::string_view{ stage.name } == zone.name; }) };
+					if (stageIt == stages.end())
+					{
+						stageIt = stages.insert(stages.end(), StageStats{ zone.name });
+					}
+					stageIt->msPerFrame += ms;
+					stageIt->callsPerFrame += newCalls * invFrames;
+					++stageIt->nrThreads;
+					stageIt->maxThreadMsPerFrame = std::max(stageIt->maxThreadMsPerFrame, ms);
+				}
+			}
+
+			std::sort(stages.begin(), stages.end(), [](const StageStats& a, const StageStats& b) { return a.msPerFrame > b.msPerFrame; });
+			return stages;
+		}
+	}
+}
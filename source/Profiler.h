@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Zones compile to nothing when DAE_DISABLE_PROFILER is defined
+#if !defined(DAE_DISABLE_PROFILER)
+#define DAE_PROFILER 1
+#endif
+
+namespace dae
+{
+	namespace Profiler
+	{
+		// Every thread accumulates into its own counters, a zone never takes a lock or shares a cache line with another thread.
+		// Times are inclusive, a zone inside another one is counted in both.
+
+		// name has to outlive the program, string literals only
+		void AddSample(const char* name, uint64_t nanoseconds);
+		// Called once per frame by the frame thread, the breakdown is per frame
+		void EndFrame();
+
+		struct StageStats
+		{
+			const char* name{};
+			float msPerFrame{};			// summed over all threads
+			float callsPerFrame{};
+			int nrThreads{};
+			float maxThreadMsPerFrame{};	// the busiest thread alone
+		};
+		// Averages since the previous call, slowest stage first
+		std::vector<StageStats> CollectStats();
+	}
+
+	// Times its scope, use through DAE_PROFILE_ZONE
+	class ProfileZone final
+	{
+	public:
+		explicit ProfileZone(const char* name) : m_Name{ name }, m_StartTime{ std::chrono::steady_clock::now() } {}
+		~ProfileZone()
+		{
+			Profiler::AddSample(m_Name, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_StartTime).count());
+		}
+
+		ProfileZone(const ProfileZone& other) = delete;
+		ProfileZone& operator=(const ProfileZone& other) = delete;
+		ProfileZone(ProfileZone&& other) = delete;
+		ProfileZone& operator=(ProfileZone&& other) = delete;
+
+	private:
+		const char* m_Name;
+		std::chrono::steady_clock::time_point m_StartTime;
+	};
+}
+
+#if defined(DAE_PROFILER)
+#define DAE_PROFILE_CONCAT_INNER(a, b) a##b
+#define DAE_PROFILE_CONCAT(a, b) DAE_PROFILE_CONCAT_INNER(a, b)
+#define DAE_PROFILE_ZONE(name) const dae::ProfileZone DAE_PROFILE_CONCAT(profileZone, __LINE__){ name }
+#else
+#define DAE_PROFILE_ZONE(name)
+#endif
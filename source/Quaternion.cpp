@@ -0,0 +1,95 @@
+#include "pch.h"
+
+#include "Quaternion.h"
+
+#include <cmath>
+
+namespace dae
+{
+	Quaternion::Quaternion(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+
+	Quaternion Quaternion::CreateFromAxisAngle(const Vector3& axis, float angle)
+	{
+		const float halfAngle{ angle * .5f };
+		const float s{ sinf(halfAngle) };
+		return { axis.x * s, axis.y * s, axis.z * s, cosf(halfAngle) };
+	}
+
+	float Quaternion::Normalize()
+	{
+		const float m{ sqrtf(x * x + y * y + z * z + w * w) };
+		x /= m;
+		y /= m;
+		z /= m;
+		w /= m;
+
+		return m;
+	}
+
+	Quaternion Quaternion::Normalized() const
+	{
+		Quaternion q{ *this };
+		q.Normalize();
+		return q;
+	}
+
+	Quaternion Quaternion::Conjugate() const
+	{
+		return { -x, -y, -z, w };
+	}
+
+	Vector3 Quaternion::Rotate(const Vector3& v) const
+	{
+		// v + 2w(u x v) + 2u x (u x v), no full quaternion products needed
+		const Vector3 u{ x, y, z };
+		const Vector3 t{ 2.f * Vector3::Cross(u, v) };
+		return v + w * t + Vector3::Cross(u, t);
+	}
+
+	float Quaternion::Dot(const Quaternion& a, const Quaternion& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	}
+
+	Quaternion Quaternion::Slerp(const Quaternion& a, const Quaternion& b, float t)
+	{
+		// q and -q are the same rotation, take the short way around
+		float cosAngle{ Dot(a, b) };
+		const float sign{ cosAngle < 0.f ? -1.f : 1.f };
+		cosAngle *= sign;
+
+		float weightA{ 1.f - t };
+		float weightB{ t };
+		if (cosAngle < .9995f)
+		{
+			const float angle{ acosf(cosAngle) };
+			const float invSin{ 1.f / sinf(angle) };
+			weightA = sinf((1.f - t) * angle) * invSin;
+			weightB = sinf(t * angle) * invSin;
+		}
+		weightB *= sign;
+
+		return Quaternion{
+			weightA * a.x + weightB * b.x,
+			weightA * a.y + weightB * b.y,
+			weightA * a.z + weightB * b.z,
+			weightA * a.w + weightB * b.w }.Normalized();
+	}
+
+#pragma region Operator Overloads
+	Quaternion Quaternion::operator*(const Quaternion& q) const
+	{
+		return {
+			w * q.x + x * q.w + y * q.z - z * q.y,
+			w * q.y - x * q.z + y * q.w + z * q.x,
+			w * q.z + x * q.y - y * q.x + z * q.w,
+			w * q.w - x * q.x - y * q.y - z * q.z
+		};
+	}
+
+	bool Quaternion::operator==(const Quaternion& q) const
+	{
+		return x == q.x && y == q.y && z == q.z && w == q.w;
+	}
+#pragma endregion
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "Vector3.h"
+
+namespace dae
+{
+	// Unit quaternion rotation, v' = q * v * conjugate(q).
+	// Composition q = a * b rotates by b first, then by a.
+	struct Quaternion
+	{
+		float x{};
+		float y{};
+		float z{};
+		float w{ 1.f };
+
+		Quaternion() = default;
+		Quaternion(float _x, float _y, float _z, float _w);
+
+		// Right handed rotation of angle (radians) around a normalized axis
+		static Quaternion CreateFromAxisAngle(const Vector3& axis, float angle);
+
+		float Normalize();
+		Quaternion Normalized() const;
+		Quaternion Conjugate() const;
+
+		Vector3 Rotate(const Vector3& v) const;
+
+		// Shortest path interpolation, falls back to a normalized lerp for nearly equal rotations
+		static Quaternion Slerp(const Quaternion& a, const Quaternion& b, float t);
+		static float Dot(const Quaternion& a, const Quaternion& b);
+
+		Quaternion operator*(const Quaternion& q) const;
+		bool operator==(const Quaternion& q) const;
+	};
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include "JobSystem.h"
+
+namespace dae
+{
+	namespace Utils
+	{
+		// Sort item, ordered on key only, value rides along (e.g. a triangle index)
+		struct SortItem
+		{
+			uint32_t key{};
+			uint32_t value{};
+		};
+
+		// Turns a float into a key that sorts in the same order as the float
+		inline uint32_t FloatToSortKey(float f)
+		{
+			uint32_t bits{};
+			std::memcpy(&bits, &f, sizeof(float));
+			return (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+		}
+
+		/**
+		 * \brief Stable LSD radix sort, 4 passes of 8 bits.
+		 * Every pass builds a histogram per chunk, chunks run as jobs once there are enough items to be worth it.
+		 * The prefix sum over (digit, chunk) gives every chunk its own output range, so the scatter is parallel as well.
+		 */
+		inline void RadixSort(std::vector<SortItem>& items, JobSystem& jobSystem)
+		{
+			constexpr size_t nrBuckets{ 256 };
+			constexpr size_t minItemsPerChunk{ 4096 };
+
+			const size_t count{ items.size() };
+			if (count < 2) return;
+
+			const size_t nrChunks{ std::clamp<size_t>(count / minItemsPerChunk, 1, static_cast<size_t>(jobSystem.GetThreadCount())) };
+			const size_t chunkSize{ (count + nrChunks - 1) / nrChunks };
+
+			std::vector<SortItem> scratch(count);
+			std::vector<size_t> histograms(nrChunks * nrBuckets);
+
+			auto forEachChunk = [nrChunks, &jobSystem](const auto& function)
+				{
+					jobSystem.ParallelFor(nrChunks, 1, [&function](size_t begin, size_t end)
+						{
+							for (size_t chunk{ begin }; chunk < end; ++chunk) function(chunk);
+						});
+				};
+
+			std::vector<SortItem>* pSource{ &items };
+			std::vector<SortItem>* pDestination{ &scratch };
+			for (uint32_t shift{}; shift < 32; shift += 8)
+			{
+				std::fill(histograms.begin(), histograms.end(), 0);
+
+				// 1. Histogram per chunk
+				forEachChunk([&, shift](size_t chunk)
+					{
+						size_t* pHistogram{ &histograms[chunk * nrBuckets] };
+						const size_t end{ std::min(count, (chunk + 1) * chunkSize) };
+						for (size_t i{ chunk * chunkSize }; i < end; ++i)
+						{
+							++pHistogram[((*pSource)[i].key >> shift) & 0xFF];
+						}
+					});
+
+				// 2. Exclusive prefix sum, digit major so equal digits keep their chunk order (stable)
+				size_t offset{};
+				for (size_t digit{}; digit < nrBuckets; ++digit)
+				{
+					for (size_t chunk{}; chunk < nrChunks; ++chunk)
+					{
+						const size_t digitCount{ histograms[chunk * nrBuckets + digit] };
+						histograms[chunk * nrBuckets + digit] = offset;
+						offset += digitCount;
+					}
+				}
+
+				// 3. Scatter
+				forEachChunk([&, shift](size_t chunk)
+					{
+						size_t* pOffsets{ &histograms[chunk * nrBuckets] };
+						const size_t end{ std::min(count, (chunk + 1) * chunkSize) };
+						for (size_t i{ chunk * chunkSize }; i < end; ++i)
+						{
+							const SortItem& item{ (*pSource)[i] };
+							(*pDestination)[pOffsets[(item.key >> shift) & 0xFF]++] = item;
+						}
+					});
+
+				std::swap(pSource, pDestination);
+			}
+
+			// 4 passes, so the result ended up back in items
+		}
+	}
+}
@@ -4,14 +4,25 @@
 #include "Mesh.h"
 #include "ShadedEffect.h"
 #include "Texture.h"
+#include "TextureManager.h"
+#include "LightClusters.h"
+#include "ShadowMap.h"
+#include "RadixSort.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "Presenter.h"
+
+#include <chrono>
+#include <bit>
 
 #include "HelperFuncts.h"
 #include "Utils.h"
 
 namespace dae {
 
-	Renderer::Renderer(SDL_Window* pWindow) 
-		:m_pWindow(pWindow)
+	Renderer::Renderer(SDL_Window* pWindow, int nrWorkers) 
+		:m_pJobSystem{ std::make_unique<JobSystem>(nrWorkers) }
+		,m_pWindow(pWindow)
 	{
 		m_pCurrentRendererfunction = [this] {Render_hardware(); };
 		m_IsUsingHardware = true;
@@ -39,12 +50,14 @@ namespace dae {
 		// Initialize Software pipeline
 		//----------------------------------------------
 		//Create Buffers
-		m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
-		m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
-		m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+		m_pPresenter = std::make_unique<Presenter>(pWindow, m_Width, m_Height);
 
+		// Sized for full scale, a lower internal resolution uses the front part
 		m_pDepthBufferPixels = new float[m_Width * m_Height];
 		ResetDepthBuffer();
+		m_ScaledBackBuffer.resize(static_cast<size_t>(m_Width) * m_Height);
+		m_HistoryBuffer.resize(static_cast<size_t>(m_Width) * m_Height);
+		m_IsHistoryMiss.resize(static_cast<size_t>(m_Width) * m_Height);
 
 		//----------------------------------------------
 		// Initialize Camera
@@ -54,33 +67,47 @@ namespace dae {
 		//----------------------------------------------
 		// Initialize meshes
 		//----------------------------------------------
-		auto pShadedEffect{ std::make_unique<ShadedEffect>(m_pDevice, L"Resources/PosCol3D.fx") };
+		m_pTextureManager = std::make_unique<TextureManager>(*m_pJobSystem, m_TextureBudgetBytes);
 
-		m_pVehicleDiffuseTexture = std::make_unique<Texture>( m_pDevice, "Resources/vehicle_diffuse.png" );
-		m_pVehicleNormalTexture = std::make_unique<Texture>( m_pDevice, "Resources/vehicle_normal.png" );
-		m_pVehicleSpecularTexture = std::make_unique<Texture>( m_pDevice, "Resources/vehicle_specular.png" );
-		m_pVehicleGlossinessTexture = std::make_unique<Texture>( m_pDevice, "Resources/vehicle_gloss.png" );
-		pShadedEffect->SetDiffuseMap(m_pVehicleDiffuseTexture.get());
-		pShadedEffect->SetNormalMap(m_pVehicleNormalTexture.get());
-		pShadedEffect->SetSpecularMap(m_pVehicleSpecularTexture.get());
-		pShadedEffect->SetGlossinessMap(m_pVehicleGlossinessTexture.get());
+		// Textures are decoded in parallel by background jobs, meshes start out with a flat placeholder and get the real texture bound once it resolves
+		m_pVehicleDiffuseTexture = std::make_unique<TextureHandle>(*m_pJobSystem, m_pDevice, "Resources/vehicle_diffuse.png", colors::Gray);
+		m_pVehicleNormalTexture = std::make_unique<TextureHandle>(*m_pJobSystem, m_pDevice, "Resources/vehicle_normal.png", ColorRGB{ .5f, .5f, 1.f });
+		m_pVehicleSpecularTexture = std::make_unique<TextureHandle>(*m_pJobSystem, m_pDevice, "Resources/vehicle_specular.png", colors::Black);
+		m_pVehicleGlossinessTexture = std::make_unique<TextureHandle>(*m_pJobSystem, m_pDevice, "Resources/vehicle_gloss.png", colors::Black);
+		m_pFireDiffuseTexture = std::make_unique<TextureHandle>(*m_pJobSystem, m_pDevice, "Resources/fireFX_diffuse.png", colors::Black, 0.f);
+
+		auto pShadedEffect{ std::make_unique<ShadedEffect>(m_pDevice, L"Resources/PosCol3D.fx") };
+		ShadedEffect* pVehicleEffect{ pShadedEffect.get() };
+		m_pVehicleDiffuseTexture->OnResolved([pVehicleEffect](Texture* pTexture) { pVehicleEffect->SetDiffuseMap(pTexture); });
+		m_pVehicleNormalTexture->OnResolved([pVehicleEffect](Texture* pTexture) { pVehicleEffect->SetNormalMap(pTexture); });
+		m_pVehicleSpecularTexture->OnResolved([pVehicleEffect](Texture* pTexture) { pVehicleEffect->SetSpecularMap(pTexture); });
+		m_pVehicleGlossinessTexture->OnResolved([pVehicleEffect](Texture* pTexture) { pVehicleEffect->SetGlossinessMap(pTexture); });
 
 		m_pMeshes.push_back(new Mesh{ m_pDevice, "Resources/vehicle.obj", std::move(pShadedEffect) });
 
 		auto pEffect{ std::make_unique<Effect>(m_pDevice, L"Resources/Transparent3D.fx") };
-
-		Texture fireDiffuseTexture{ m_pDevice, "Resources/fireFX_diffuse.png" };
-		pEffect->SetDiffuseMap(&fireDiffuseTexture);
+		Effect* pFireEffect{ pEffect.get() };
+		m_pFireDiffuseTexture->OnResolved([pFireEffect](Texture* pTexture) { pFireEffect->SetDiffuseMap(pTexture); });
 
 		Mesh* pFireFX = new Mesh{ m_pDevice, "Resources/fireFX.obj",std::move(pEffect) };
 		m_pFireFX = pFireFX;
 		m_pMeshes.push_back(pFireFX);
 
+		//----------------------------------------------
+		// Initialize lights
+		//----------------------------------------------
+		CreateLocalLights();
+		m_pLightClusters = std::make_unique<LightClusters>(m_Width, m_Height);
+		m_pShadowMap = std::make_unique<ShadowMap>(m_ShadowMapSize);
+
+		// Tiles and upscale tables, starts at full scale
+		ResizeRenderTarget();
+
 		for (auto& pMesh : m_pMeshes)
 		{
 			pMesh->Translate(0, 0, 50);
 			pMesh->SetFilteringMethod(m_FilteringMethod);
-			pMesh->SetCullingMode(m_CullingMode);
+			pMesh->SetCullingMode(m_Settings.cullingMode);
 		}
 
 		//----------------------------------------------
@@ -92,13 +119,13 @@ namespace dae {
 		cout << "[Key bindings - SHARED]" << '\n';
 		cout << "	[F1]  Toggle Rasterizer Mode (HARDWARE/SOFTWARE)" << '\n';
 		cout << "	[F2]  Toggle Vehicle Rotation (ON/OFF)" << '\n';
+		cout << "	[F3]  Toggle FireFX (ON/OFF)" << '\n';
 		cout << "	[F9]  Cycle CullMode (BACK/FRONT/NONE)" << '\n';
 		cout << "	[F10] Toggle Uniform ClearColor (ON/OFF)" << '\n';
 		cout << "	[F11] Toggle Print FPS (ON/OFF)" << '\n';
 		cout << '\n';
 		cout << GREEN;
 		cout << "[Key bindings - HARDWARE]" << '\n';
-		cout << "	[F3]  Toggle FireFX (ON/OFF)" << '\n';
 		cout << "	[F4]  Cycle Sampler State (POINT/LINEAR/ANISOTROPIC)" << '\n';
 		cout << '\n';
 		cout << MAGENTA;
@@ -107,6 +134,16 @@ namespace dae {
 		cout << "	[F6]  Toggle NormalMap (ON/OFF)" << '\n';
 		cout << "	[F7]  Toggle DepthBuffer Visualization (ON/OFF)" << '\n';
 		cout << "	[F8]  Toggle BoundingBox Visualization (ON/OFF)" << '\n';
+		cout << "	[1]   Toggle Local Lights (ON/OFF)" << '\n';
+		cout << "	[2]   Toggle Shadows (ON/OFF)" << '\n';
+		cout << "	[3]   Toggle Z-Prepass (ON/OFF)" << '\n';
+		cout << "	[4]   Toggle Frame Pipelining (ON/OFF)" << '\n';
+		cout << "	[5]   Cycle Latency Mode (ZERO_COPY/THROUGHPUT/LOW_LATENCY)" << '\n';
+		cout << "	[6]   Toggle Dynamic Resolution (ON/OFF)" << '\n';
+		cout << "	[7]   Toggle Checkerboard Rendering (ON/OFF)" << '\n';
+		cout << "	[8]   Toggle Variable Rate Shading (ON/OFF)" << '\n';
+		cout << "	[9]   Toggle Shading Rate Visualization (ON/OFF)" << '\n';
+		cout << "	[0]   Toggle Incremental Rendering (ON/OFF)" << '\n';
 		cout << '\n';
 		cout << RESET;
 
@@ -114,6 +151,19 @@ namespace dae {
 
 	Renderer::~Renderer()
 	{
+		// The frame in flight still uses everything below
+		m_pJobSystem->Wait(m_RenderJob);
+		m_pPresenter.reset();
+
+		m_pTextureManager.reset();
+
+		// Wait for textures that are still loading, they need the device
+		m_pVehicleDiffuseTexture.reset();
+		m_pVehicleNormalTexture.reset();
+		m_pVehicleSpecularTexture.reset();
+		m_pVehicleGlossinessTexture.reset();
+		m_pFireDiffuseTexture.reset();
+
 		for (auto& pMesh : m_pMeshes)
 		{
 			delete pMesh;
@@ -144,26 +194,358 @@ namespace dae {
 		SAFE_RELEASE(m_pDevice);
 	}
 
+	void Renderer::HandleInput(const InputEvent& input)
+	{
+		m_PendingInput.push_back(input);
+	}
+
 	void Renderer::Update(const Timer* pTimer)
 	{
-		m_Camera.Update(pTimer);
+		DAE_PROFILE_ZONE("Update");
 
-		for (auto& pMesh : m_pMeshes)
+		// Nothing to interpolate from before the first step
+		if (m_PreviousMeshTransforms.size() != m_pMeshes.size())
+		{
+			m_PreviousCamera = m_Camera;
+			m_PreviousMeshTransforms.resize(m_pMeshes.size());
+			for (size_t meshIdx{}; meshIdx < m_pMeshes.size(); ++meshIdx)
+			{
+				const Mesh* pMesh{ m_pMeshes[meshIdx] };
+				m_PreviousMeshTransforms[meshIdx] = { pMesh->GetPosition(), pMesh->GetRotation(), pMesh->GetScale() };
+			}
+		}
+
+		const Clock::time_point now{ Clock::now() };
+		constexpr float maxAccumulatedTime{ m_MaxStepsPerUpdate * m_FixedTimeStep };
+		m_SimulationAccumulator += pTimer->GetElapsed();
+		if (m_SimulationAccumulator > maxAccumulatedTime)
+		{
+			m_SimulationStats.droppedMs += (m_SimulationAccumulator - maxAccumulatedTime) * 1000.f;
+			m_SimulationAccumulator = maxAccumulatedTime;
+		}
+
+		size_t inputIdx{};
+		while (m_SimulationAccumulator >= m_FixedTimeStep)
+		{
+			m_SimulationAccumulator -= m_FixedTimeStep;
+			// Steps end where the leftover time starts, the last one just before now
+			const Clock::time_point stepEndTime{ now - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(m_SimulationAccumulator)) };
+
+			m_Camera.BeginStep(stepEndTime - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(m_FixedTimeStep)));
+			for (; inputIdx < m_PendingInput.size() && m_PendingInput[inputIdx].timestamp <= stepEndTime; ++inputIdx)
+			{
+				m_Camera.HandleInput(m_PendingInput[inputIdx]);
+			}
+			Simulate(stepEndTime);
+		}
+		m_PendingInput.erase(m_PendingInput.begin(), m_PendingInput.begin() + inputIdx);
+
+		// The frame shows the state the leftover time is into the next step
+		const float alpha{ m_SimulationAccumulator / m_FixedTimeStep };
+		const auto lerp = [alpha](float previous, float current) { return previous == current ? current : Lerpf(previous, current, alpha); };
+
+		Camera camera{ m_Camera };
+		camera.origin = { lerp(m_PreviousCamera.origin.x, m_Camera.origin.x), lerp(m_PreviousCamera.origin.y, m_Camera.origin.y), lerp(m_PreviousCamera.origin.z, m_Camera.origin.z) };
+		camera.totalYaw = lerp(m_PreviousCamera.totalYaw, m_Camera.totalYaw);
+		camera.totalPitch = lerp(m_PreviousCamera.totalPitch, m_Camera.totalPitch);
+		camera.CalculateViewMatrix();
+
+		std::vector<MeshTransform> meshTransforms(m_pMeshes.size());
+		for (size_t meshIdx{}; meshIdx < m_pMeshes.size(); ++meshIdx)
+		{
+			Mesh* pMesh{ m_pMeshes[meshIdx] };
+			meshTransforms[meshIdx] = InterpolateTransform(m_PreviousMeshTransforms[meshIdx], { pMesh->GetPosition(), pMesh->GetRotation(), pMesh->GetScale() }, alpha);
+
+			const MeshTransform& transform{ meshTransforms[meshIdx] };
+			pMesh->UpdateViewMatrices(AffineTransform::CreateTRS(transform.position, transform.rotation, transform.scale), camera.GetWorldViewProjection(), camera.GetInverseViewMatrix());
+		}
+
+		CaptureFrame(camera, meshTransforms);
+	}
+
+	void Renderer::Simulate(Clock::time_point stepEndTime)
+	{
+		DAE_PROFILE_ZONE("Simulation step");
+
+		m_PreviousCamera = m_Camera;
+		for (size_t meshIdx{}; meshIdx < m_pMeshes.size(); ++meshIdx)
+		{
+			const Mesh* pMesh{ m_pMeshes[meshIdx] };
+			m_PreviousMeshTransforms[meshIdx] = { pMesh->GetPosition(), pMesh->GetRotation(), pMesh->GetScale() };
+		}
+
+		m_Camera.Update(m_FixedTimeStep, stepEndTime);
+
+		if (m_EnableRotation)
+		{
+			for (auto& pMesh : m_pMeshes)
+			{
+				pMesh->RotateY(m_RotationSpeed * m_FixedTimeStep * TO_RADIANS);
+			}
+		}
+
+		++m_SimulationStats.steps;
+	}
+
+	Renderer::MeshTransform Renderer::InterpolateTransform(const MeshTransform& previous, const MeshTransform& current, float alpha)
+	{
+		// A transform that didn't change comes out bit for bit the same, incremental rendering compares them
+		const auto lerp = [alpha](const Vector3& a, const Vector3& b)
+			{
+				return Vector3{ a.x == b.x ? b.x : Lerpf(a.x, b.x, alpha), a.y == b.y ? b.y : Lerpf(a.y, b.y, alpha), a.z == b.z ? b.z : Lerpf(a.z, b.z, alpha) };
+			};
+		return {
+			lerp(previous.position, current.position),
+			previous.rotation == current.rotation ? current.rotation : Quaternion::Slerp(previous.rotation, current.rotation, alpha),
+			lerp(previous.scale, current.scale)
+		};
+	}
+
+	void Renderer::CaptureFrame(const Camera& camera, const std::vector<MeshTransform>& meshTransforms)
+	{
+		// The snapshot the render isn't reading
+		FrameSnapshot& frame{ m_Frames[1 - m_RenderFrameIdx] };
+		frame.camera = camera;
+		frame.meshTransforms = meshTransforms;
+		frame.settings = m_Settings;
+		frame.updateTime = Clock::now();
+	}
+
+	void Renderer::FinishFrame()
+	{
+		if (!m_RenderJob.IsValid()) return;
+
+		// Already handed to the present thread by the render job
+		m_pJobSystem->Wait(m_RenderJob);
+		m_RenderJob = {};
+	}
+
+	void Renderer::RecordFrameLatency()
+	{
+		constexpr float latencySmoothing{ 0.1f };
+		const float latencyMs{ std::chrono::duration<float, std::milli>(Clock::now() - GetRenderFrame().updateTime).count() };
+		m_FrameLatencyMs = Lerpf(m_FrameLatencyMs, latencyMs, latencySmoothing);
+	}
+
+
+	bool Renderer::ResolveTextures()
+	{
+		bool hasChanged{ false };
+		for (const auto& pTexture : { m_pVehicleDiffuseTexture.get(), m_pVehicleNormalTexture.get(), m_pVehicleSpecularTexture.get(), m_pVehicleGlossinessTexture.get(), m_pFireDiffuseTexture.get() })
+		{
+			if (pTexture->Resolve())
+			{
+				m_pTextureManager->Register(pTexture->Get());
+				hasChanged = true;
+			}
+		}
+
+		return m_pTextureManager->Update() || hasChanged;
+	}
+
+	Renderer::FrameChange Renderer::DetectFrameChange(bool haveTexturesChanged)
+	{
+		FrameSnapshot& frame{ m_Frames[m_RenderFrameIdx] };
+		const FrameSnapshot& last{ m_LastRenderedFrame };
+		frame.changedMeshes.assign(frame.meshTransforms.size(), uint8_t{ 0 });
+
+		const Camera& camera{ frame.camera };
+		const bool hasCameraChanged{ camera.GetViewMatrix() != last.camera.GetViewMatrix()
+			|| camera.fov != last.camera.fov || camera.aspectRatio != last.camera.aspectRatio
+			|| camera.nearPlane != last.camera.nearPlane || camera.farPlane != last.camera.farPlane };
+
+		if (!frame.settings.enableIncrementalRendering || haveTexturesChanged || m_ForceFullFrame || hasCameraChanged
+			|| !(frame.settings == last.settings) || frame.meshTransforms.size() != last.meshTransforms.size())
+		{
+			frame.change = FrameChange::Full;
+		}
+		else
 		{
-			if (m_EnableRotation)
+			frame.change = FrameChange::None;
+			for (size_t meshIdx{}; meshIdx < frame.meshTransforms.size(); ++meshIdx)
 			{
-				pMesh->RotateY(m_RotationSpeed * pTimer->GetElapsed() * TO_RADIANS);
+				const MeshTransform& curr{ frame.meshTransforms[meshIdx] };
+				const MeshTransform& prev{ last.meshTransforms[meshIdx] };
+				const bool hasMoved{ curr.position.x != prev.position.x || curr.position.y != prev.position.y || curr.position.z != prev.position.z
+					|| !(curr.rotation == prev.rotation)
+					|| curr.scale.x != prev.scale.x || curr.scale.y != prev.scale.y || curr.scale.z != prev.scale.z };
+				if (!hasMoved) continue;
+
+				frame.changedMeshes[meshIdx] = 1;
+				frame.change = FrameChange::Meshes;
 			}
-			pMesh->UpdateViewMatrices(m_Camera.GetWorldViewProjection(), m_Camera.GetInverseViewMatrix());
 		}
+
+		// Accumulated results keep improving for a few frames after the last change
+		const bool isConverging{ frame.settings.enableCheckerboard || frame.settings.enableVariableRateShading };
+		if (frame.change != FrameChange::None)
+		{
+			m_NrSettleFrames = isConverging ? m_SettleFrameCount : 0;
+		}
+		else if (m_NrSettleFrames > 0)
+		{
+			--m_NrSettleFrames;
+			frame.change = FrameChange::Full;
+		}
+
+		m_ForceFullFrame = false;
+		switch (frame.change)
+		{
+		case FrameChange::None:
+			++m_IncrementalStats.skippedFrames;
+			return frame.change;
+		case FrameChange::Meshes:
+			++m_IncrementalStats.partialFrames;
+			break;
+		default:
+			++m_IncrementalStats.fullFrames;
+			break;
+		}
+
+		m_LastRenderedFrame = frame;
+		return frame.change;
+	}
+
+	void Renderer::PrintStats() const
+	{
+		// The render job writes most of these
+		m_pJobSystem->Wait(m_RenderJob);
+
+		const Presenter::Stats presentStats{ m_pPresenter->GetStats() };
+		std::cout << WHITE << "[FRAME] " << (m_EnableFramePipelining && !m_IsUsingHardware ? "pipelined" : "serial")
+			<< ", update -> present latency: " << (m_IsUsingHardware ? m_FrameLatencyMs : presentStats.latencyMs) << " ms\n" << RESET;
+		constexpr const char* latencyModeNames[static_cast<int>(Presenter::LatencyMode::END)]{ "zero copy", "throughput", "low latency" };
+		std::cout << WHITE << "[PRESENT] " << latencyModeNames[static_cast<int>(m_pPresenter->GetLatencyMode())]
+			<< " (" << m_pPresenter->GetPixelFormatName() << ")"
+			<< ", presented: " << presentStats.presentedFrames
+			<< ", dropped: " << presentStats.droppedFrames
+			<< ", waiting for a buffer: " << presentStats.acquireWaitMs << " ms\n" << RESET;
+		const TextureManager::Stats stats{ m_pTextureManager->GetStats() };
+		std::cout << WHITE << "[TEXTURES] resident: " << stats.residentBytes / 1024 << " / " << stats.budgetBytes / 1024 << " KB"
+			<< ", misses: " << stats.misses
+			<< ", streamed: " << stats.streamedMips
+			<< ", evicted: " << stats.evictedMips
+			<< ", latency avg/max: " << stats.averageLatencyMs << " / " << stats.maxLatencyMs << " ms\n" << RESET;
+		// Per frame, only the strategy in use is measured
+		std::cout << WHITE << "[OPAQUE PASS] ";
+		if (m_OpaquePassTimings.isPrepass)
+		{
+			std::cout << "z-prepass: " << m_OpaquePassTimings.prepassDepthMs + m_OpaquePassTimings.prepassColorMs << " ms (depth " << m_OpaquePassTimings.prepassDepthMs << " + color " << m_OpaquePassTimings.prepassColorMs << ")"
+				<< ", direct: not measured\n" << RESET;
+		}
+		else
+		{
+			std::cout << "direct: " << m_OpaquePassTimings.directMs << " ms"
+				<< ", z-prepass: not measured\n" << RESET;
+		}
+		std::cout << WHITE << "[RESOLUTION] " << (m_Settings.enableDynamicResolution ? "dynamic" : "fixed")
+			<< ", " << m_RenderWidth << "x" << m_RenderHeight << " of " << m_Width << "x" << m_Height << " (" << static_cast<int>(m_RenderScale * 100.f + 0.5f) << "%)"
+			<< ", render: " << m_ResolutionStats.renderMs << " ms (target " << m_TargetFrameMs << " ms)"
+			<< ", upscale: " << m_ResolutionStats.upscaleMs << " ms"
+			<< ", cost: " << m_ResolutionStats.msPerMegapixel << " ms/MP"
+			<< ", changes: " << m_ResolutionStats.resolutionChanges << '\n' << RESET;
+		std::cout << WHITE << "[CHECKERBOARD] " << (m_Settings.enableCheckerboard ? "Enabled" : "Disabled")
+			<< ", reconstructed: " << m_CheckerboardStats.reconstructedPixels << " pixels"
+			<< ", history misses: " << m_CheckerboardStats.historyMisses << '\n' << RESET;
+		std::cout << WHITE << "[VRS] " << (m_Settings.enableVariableRateShading ? "Enabled" : "Disabled")
+			<< ", tiles at 1x1: " << m_ShadingRateCounts[static_cast<int>(ShadingRate::Rate1x1)]
+			<< ", 2x2: " << m_ShadingRateCounts[static_cast<int>(ShadingRate::Rate2x2)]
+			<< ", 4x4: " << m_ShadingRateCounts[static_cast<int>(ShadingRate::Rate4x4)] << '\n' << RESET;
+		std::cout << WHITE << "[INCREMENTAL] " << (m_Settings.enableIncrementalRendering ? "Enabled" : "Disabled")
+			<< ", full: " << m_IncrementalStats.fullFrames
+			<< ", partial: " << m_IncrementalStats.partialFrames
+			<< ", skipped: " << m_IncrementalStats.skippedFrames
+			<< ", last frame rendered " << static_cast<int>(m_DirtyTileRatio * 100.f + 0.5f) << "% of the tiles\n" << RESET;
+		std::cout << WHITE << "[SIMULATION] fixed step: " << m_FixedTimeStep * 1000.f << " ms"
+			<< ", steps: " << m_SimulationStats.steps
+			<< ", dropped: " << m_SimulationStats.droppedMs << " ms\n" << RESET;
+		std::cout << WHITE << "[SHADOWS] " << (m_Settings.enableShadows ? "Enabled" : "Disabled") << ", map rebuilds: " << m_pShadowMap->GetRebuildCount() << '\n' << RESET;
+		const JobSystem::Stats jobStats{ m_pJobSystem->GetStats() };
+		std::cout << WHITE << "[JOBS] threads: " << m_pJobSystem->GetThreadCount() << " (" << m_pJobSystem->GetWorkerCount() << " workers + frame thread)"
+			<< ", executed: " << jobStats.executedJobs
+			<< ", stolen: " << jobStats.stolenJobs << '\n' << RESET;
+#if defined(DAE_PROFILER)
+		// Inclusive per stage, summed over the threads that ran it
+		std::cout << WHITE << "[PROFILE] ms per frame (calls, threads, busiest thread)\n";
+		for (const Profiler::StageStats& stage : Profiler::CollectStats())
+		{
+			std::cout << "	" << stage.name << ": " << stage.msPerFrame << " ms"
+				<< " (" << stage.callsPerFrame << "x, " << stage.nrThreads << ", " << stage.maxThreadMsPerFrame << " ms)\n";
+		}
+		std::cout << RESET;
+#endif
 	}
 
+	void Renderer::CreateLocalLights()
+	{
+		// Ring of colored point lights around the vehicle, with a few spot lights shining down on it
+		const Vector3 center{ 0.f, 0.f, 50.f };
+		constexpr int nrPointLights{ 96 };
+		for (int i{}; i < nrPointLights; ++i)
+		{
+			const float angle{ PI_2 * i / nrPointLights };
+			const float radius{ 12.f + 4.f * (i % 3) };
+
+			LocalLight light{};
+			light.type = LightType::Point;
+			light.position = center + Vector3{ cosf(angle) * radius, -2.f + 3.f * (i % 4), sinf(angle) * radius };
+			light.color = ColorRGB{ 0.5f + 0.5f * cosf(angle), 0.5f + 0.5f * cosf(angle + PI_2 / 3.f), 0.5f + 0.5f * cosf(angle - PI_2 / 3.f) };
+			light.intensity = 25.f;
+			light.range = 10.f;
+			m_Lights.push_back(light);
+		}
+
+		constexpr int nrSpotLights{ 4 };
+		for (int i{}; i < nrSpotLights; ++i)
+		{
+			const float angle{ PI_2 * i / nrSpotLights + PI_DIV_4 };
+
+			LocalLight light{};
+			light.type = LightType::Spot;
+			light.position = center + Vector3{ cosf(angle) * 10.f, 15.f, sinf(angle) * 10.f };
+			light.direction = (center - light.position).Normalized();
+			light.color = colors::White;
+			light.intensity = 150.f;
+			light.range = 30.f;
+			light.cosInnerCone = cosf(15.f * TO_RADIANS);
+			light.cosOuterCone = cosf(25.f * TO_RADIANS);
+			m_Lights.push_back(light);
+		}
+	}
 
-	void Renderer::Render() const
+	void Renderer::Render()
 	{
 		if (!m_IsInitialized)
 			return;
 
+		// Frame N has to be done before its snapshot can be reused
+		FinishFrame();
+
+		// Nothing renders at this point, so textures and streamed mips can be swapped in
+		const bool haveTexturesChanged{ ResolveTextures() };
+
+		m_RenderFrameIdx = 1 - m_RenderFrameIdx;
+
+		// What is on screen is still up to date, the last presented frame stays
+		m_IsIdle = !m_IsUsingHardware && DetectFrameChange(haveTexturesChanged) == FrameChange::None;
+		if (m_IsIdle) return;
+
+		if (m_EnableFramePipelining && !m_IsUsingHardware)
+		{
+			// Submits its buffer to the present thread when done, the next Render call only waits for the raster
+			m_RenderJob = m_pJobSystem->Schedule([this] { Render_software(); });
+			return;
+		}
+
+		if (m_IsUsingHardware)
+		{
+			// A software frame that is still queued would be drawn over the swap chain
+			m_pPresenter->Flush();
+			m_pCurrentRendererfunction();
+			RecordFrameLatency();
+			return;
+		}
+
 		m_pCurrentRendererfunction();
 	}
 
@@ -179,6 +561,8 @@ namespace dae {
 			m_pCurrentRendererfunction = [this] {Render_hardware(); };
 			m_IsUsingHardware = true;
 		}
+		// The internal buffer has gone stale in the meantime
+		m_ForceFullFrame = true;
 		std::cout << YELLOW << "[GLOBAL MODE] " << (m_IsUsingHardware ? "Hardware" : "Software") << '\n' << RESET;
 	}
 
@@ -192,16 +576,16 @@ namespace dae {
 	{
 		std::cout << YELLOW << "[CULLMODE] Not implemented yet!\n" << RESET;
 
-		m_CullingMode = static_cast<CullingMode>((static_cast<int>(m_CullingMode) + 1) % (static_cast<int>(CullingMode::END)));
+		m_Settings.cullingMode = static_cast<CullingMode>((static_cast<int>(m_Settings.cullingMode) + 1) % (static_cast<int>(CullingMode::END)));
 		for (const auto& pMesh : m_pMeshes)
 		{
 			if (pMesh == m_pFireFX) continue;
 
-			pMesh->SetCullingMode(m_CullingMode);
+			pMesh->SetCullingMode(m_Settings.cullingMode);
 		}
 
 		std::cout << GREEN << "[CULLINGMODE] ";
-		switch (m_CullingMode)
+		switch (m_Settings.cullingMode)
 		{
 		case dae::CullingMode::Front:
 			std::cout << "Front\n";
@@ -218,16 +602,14 @@ namespace dae {
 
 	void Renderer::ToggleUniformClearColor()
 	{
-		m_EnableUniformClearColor = !m_EnableUniformClearColor;
-		std::cout << YELLOW << "[UNIFORM COLOR] " << (m_EnableUniformClearColor ? "Enabled" : "Disabled") << '\n' << RESET;
+		m_Settings.enableUniformClearColor = !m_Settings.enableUniformClearColor;
+		std::cout << YELLOW << "[UNIFORM COLOR] " << (m_Settings.enableUniformClearColor ? "Enabled" : "Disabled") << '\n' << RESET;
 	}
 
 	void Renderer::ToggleFireFXMesh()
 	{
-		if (!m_IsUsingHardware) return;
-
-		m_EnableFireFX = !m_EnableFireFX;
-		std::cout << GREEN << "[FIREFX] " << (m_EnableFireFX ? "Enabled" : "Disabled") << '\n' << RESET;
+		m_Settings.enableFireFX = !m_Settings.enableFireFX;
+		std::cout << GREEN << "[FIREFX] " << (m_Settings.enableFireFX ? "Enabled" : "Disabled") << '\n' << RESET;
 	}
 
 	void Renderer::ToggleTextureSamplingStates()
@@ -260,10 +642,10 @@ namespace dae {
 	{
 		if (m_IsUsingHardware) return;
 
-		m_ShadingMode = static_cast<ShadingMode>((static_cast<int>(m_ShadingMode) + 1) % (static_cast<int>(ShadingMode::END)));
+		m_Settings.shadingMode = static_cast<ShadingMode>((static_cast<int>(m_Settings.shadingMode) + 1) % (static_cast<int>(ShadingMode::END)));
 
 		std::cout << MAGENTA << "[SHADINGMODE] ";
-		switch (m_ShadingMode)
+		switch (m_Settings.shadingMode)
 		{
 		case dae::Renderer::ShadingMode::ObservedArea:
 			std::cout << "Observed Area\n";
@@ -285,304 +667,1656 @@ namespace dae {
 	{
 		if (m_IsUsingHardware) return;
 
-		m_EnableNormalMap = !m_EnableNormalMap;
-		std::cout << MAGENTA << "[NORMAL MAP] " << (m_EnableNormalMap ? "Enabled" : "Disabled") << '\n' << RESET;
+		m_Settings.enableNormalMap = !m_Settings.enableNormalMap;
+		std::cout << MAGENTA << "[NORMAL MAP] " << (m_Settings.enableNormalMap ? "Enabled" : "Disabled") << '\n' << RESET;
 	}
 
 	void Renderer::ToggleDepthBufferVisualisation()
 	{
 		if (m_IsUsingHardware) return;
 
-		m_EnableDepthBufferVisualisation = !m_EnableDepthBufferVisualisation;
-		std::cout << MAGENTA << "[DEPTHBUFFER VISUALISATION] " << (m_EnableDepthBufferVisualisation ? "Enabled" : "Disabled") << '\n' << RESET;
+		m_Settings.enableDepthBufferVisualisation = !m_Settings.enableDepthBufferVisualisation;
+		std::cout << MAGENTA << "[DEPTHBUFFER VISUALISATION] " << (m_Settings.enableDepthBufferVisualisation ? "Enabled" : "Disabled") << '\n' << RESET;
+	}
+
+	void Renderer::ToggleLocalLights()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_Settings.enableLocalLights = !m_Settings.enableLocalLights;
+		std::cout << MAGENTA << "[LOCAL LIGHTS] " << (m_Settings.enableLocalLights ? "Enabled" : "Disabled") << " (" << m_Lights.size() << " lights)\n" << RESET;
+	}
+
+	void Renderer::ToggleShadows()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_Settings.enableShadows = !m_Settings.enableShadows;
+		std::cout << MAGENTA << "[SHADOWS] " << (m_Settings.enableShadows ? "Enabled" : "Disabled") << '\n' << RESET;
+	}
+
+	void Renderer::ToggleZPrepass()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_Settings.enableZPrepass = !m_Settings.enableZPrepass;
+		std::cout << MAGENTA << "[Z-PREPASS] " << (m_Settings.enableZPrepass ? "Enabled" : "Disabled") << '\n' << RESET;
+	}
+
+	void Renderer::ToggleFramePipelining()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_EnableFramePipelining = !m_EnableFramePipelining;
+		std::cout << MAGENTA << "[FRAME PIPELINING] " << (m_EnableFramePipelining ? "Enabled" : "Disabled") << '\n' << RESET;
+	}
+
+	void Renderer::CycleLatencyMode()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_pPresenter->SetLatencyMode(static_cast<Presenter::LatencyMode>((static_cast<int>(m_pPresenter->GetLatencyMode()) + 1) % static_cast<int>(Presenter::LatencyMode::END)));
+
+		std::cout << MAGENTA << "[LATENCY MODE] ";
+		switch (m_pPresenter->GetLatencyMode())
+		{
+		case Presenter::LatencyMode::ZeroCopy:
+			std::cout << "Zero Copy\n";
+			break;
+		case Presenter::LatencyMode::Throughput:
+			std::cout << "Throughput\n";
+			break;
+		case Presenter::LatencyMode::LowLatency:
+			std::cout << "Low Latency\n";
+			break;
+		}
+		std::cout << RESET;
+	}
+
+	void Renderer::ToggleDynamicResolution()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_Settings.enableDynamicResolution = !m_Settings.enableDynamicResolution;
+		std::cout << MAGENTA << "[DYNAMIC RESOLUTION] " << (m_Settings.enableDynamicResolution ? "Enabled" : "Disabled") << '\n' << RESET;
+	}
+
+	void Renderer::ToggleCheckerboard()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_Settings.enableCheckerboard = !m_Settings.enableCheckerboard;
+		std::cout << MAGENTA << "[CHECKERBOARD] " << (m_Settings.enableCheckerboard ? "Enabled" : "Disabled") << '\n' << RESET;
+	}
+
+	void Renderer::ToggleVariableRateShading()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_Settings.enableVariableRateShading = !m_Settings.enableVariableRateShading;
+		std::cout << MAGENTA << "[VARIABLE RATE SHADING] " << (m_Settings.enableVariableRateShading ? "Enabled" : "Disabled") << '\n' << RESET;
+	}
+
+	void Renderer::ToggleShadingRateVisualisation()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_Settings.enableShadingRateVisualisation = !m_Settings.enableShadingRateVisualisation;
+		std::cout << MAGENTA << "[SHADING RATE VISUALISATION] " << (m_Settings.enableShadingRateVisualisation ? "Enabled" : "Disabled") << '\n' << RESET;
+	}
+
+	void Renderer::ToggleIncrementalRendering()
+	{
+		if (m_IsUsingHardware) return;
+
+		m_Settings.enableIncrementalRendering = !m_Settings.enableIncrementalRendering;
+		std::cout << MAGENTA << "[INCREMENTAL RENDERING] " << (m_Settings.enableIncrementalRendering ? "Enabled" : "Disabled") << '\n' << RESET;
 	}
 
 	void Renderer::ToggleBoundingBoxVisualisation()
 	{
 		if (m_IsUsingHardware) return;
 
-		m_EnableBoundingBoxVisualisation = !m_EnableBoundingBoxVisualisation;
-		std::cout << MAGENTA << "[BOUNDINGBOX VISUALISATION] " << (m_EnableBoundingBoxVisualisation ? "Enabled" : "Disabled") << '\n' << RESET;
+		m_Settings.enableBoundingBoxVisualisation = !m_Settings.enableBoundingBoxVisualisation;
+		std::cout << MAGENTA << "[BOUNDINGBOX VISUALISATION] " << (m_Settings.enableBoundingBoxVisualisation ? "Enabled" : "Disabled") << '\n' << RESET;
 	}
 
 	void Renderer::Render_software() const
 	{
+		DAE_PROFILE_ZONE("Render software");
+		const FrameSnapshot& frame{ GetRenderFrame() };
 		//@START
+		// Either a back buffer in the window's pixel format or the window surface itself (zero copy).
+		// Only blocks when the present thread is behind by all the buffers, or on the previous window update for zero copy.
+		m_pBackBuffer = m_pPresenter->AcquireBuffer();
+		const Clock::time_point renderStartTime{ Clock::now() };
+
+		// Below full scale the frame goes into the internal buffer and is upscaled into the acquired one at the end.
+		// Incremental rendering always keeps it there, a partial frame only renders over part of the previous one.
+		const bool hasResized{ ResizeRenderTarget() };
+		const bool isFullFrame{ frame.change == FrameChange::Full || hasResized };
+		m_IsUsingInternalBuffer = !IsRenderingAtFullScale() || frame.settings.enableIncrementalRendering;
+		m_pBackBufferPixels = m_IsUsingInternalBuffer ? m_ScaledBackBuffer.data() : static_cast<uint32_t*>(m_pBackBuffer->pixels);
+
 		//Lock BackBuffer
 		SDL_LockSurface(m_pBackBuffer);
 
+		m_pPixelShader = SelectPixelShader();
+		ResolveOutputFormat();
+
+		if (frame.settings.enableLocalLights)
+		{
+			m_pLightClusters->Build(m_Lights, frame.camera);
+		}
+
 		// Define Triangles - Vertices in WORLD space
+		// The transforms come from the snapshot, Update is already moving the meshes for the next frame
 		std::vector<UntexturedMesh> meshes_world;
-		for (const auto& pMesh : m_pMeshes)
+		for (size_t meshIdx{}; meshIdx < m_pMeshes.size(); ++meshIdx)
 		{
+			const Mesh* pMesh{ m_pMeshes[meshIdx] };
 			if (pMesh == m_pFireFX) continue;
 
+			const MeshTransform& transform{ frame.meshTransforms[meshIdx] };
 			UntexturedMesh uMesh;
 			uMesh.indices = pMesh->indices;
 			uMesh.primitiveTopology = pMesh->primitiveTopology;
 			uMesh.vertices = pMesh->vertices;
 			uMesh.vertices_out = pMesh->vertices_out;
-			uMesh.worldMatrix = pMesh->worldMatrix;
+			uMesh.SetTransform(transform.position, transform.rotation, transform.scale);
 			meshes_world.emplace_back(uMesh);
 		}
 
-		// For each mesh
-		for (auto& mesh : meshes_world)
+		if (frame.settings.enableShadows)
 		{
-			// World space --> NDC Space
-			VertexTransformationFunction(mesh);
-
-			std::vector<Vector2> vertices_raster;
-			for (const Vertex_Out& ndcVertex : mesh.vertices_out)
+			// The fire is transparent and doesn't cast
+			std::vector<const UntexturedMesh*> casters;
+			for (const UntexturedMesh& mesh : meshes_world)
 			{
-				// Formula from slides
-				// NDC --> Screenspace
-				vertices_raster.push_back({ (ndcVertex.position.x + 1) / 2.0f * m_Width, (1.0f - ndcVertex.position.y) / 2.0f * m_Height });
+				casters.push_back(&mesh);
 			}
+			m_pShadowMap->Update(m_GlobalLight.direction, casters);
+		}
 
-			// Depth buffer
-			ResetDepthBuffer();
-			ClearBackground();
-
-			// +--------------+
-			// | RENDER LOGIC |
-			// +--------------+
-			switch (mesh.primitiveTopology)
+		// World space --> NDC Space --> Screenspace, for every mesh up front, the screen bounds decide what gets rendered
+		auto toRaster = [this](UntexturedMesh& mesh)
 			{
-			case PrimitiveTopology::TriangleList:
-				// For each triangle
-				for (int currStartVertIdx{ 0 }; currStartVertIdx < mesh.indices.size(); currStartVertIdx += 3)
-				{
-					RenderMeshTriangle(mesh, vertices_raster, currStartVertIdx, false);
-				}
-				break;
-			case PrimitiveTopology::TriangleStrip:
-				// For each triangle
-				for (int currStartVertIdx{ 0 }; currStartVertIdx < mesh.indices.size() - 2; ++currStartVertIdx)
+				VertexTransformationFunction(mesh);
+
+				std::vector<Vector2> vertices_raster;
+				vertices_raster.reserve(mesh.vertices_out.size());
+				for (const Vertex_Out& ndcVertex : mesh.vertices_out)
 				{
-					RenderMeshTriangle(mesh, vertices_raster, currStartVertIdx, currStartVertIdx % 2);
+					// Formula from slides
+					// NDC --> Screenspace
+					vertices_raster.push_back({ (ndcVertex.position.x + 1) / 2.0f * m_RenderWidth, (1.0f - ndcVertex.position.y) / 2.0f * m_RenderHeight });
 				}
-				break;
-			default:
-				std::cout << "PrimitiveTopology not implemented yet\n";
-				break;
-			}
-		}
-
-		//@END
-		//Update SDL Surface
-		SDL_UnlockSurface(m_pBackBuffer);
-		SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
-		SDL_UpdateWindowSurface(m_pWindow);
-	}
-
-	void dae::Renderer::VertexTransformationFunction(UntexturedMesh& mesh) const
-	{
-		Matrix worldViewProjectionMatrix{ mesh.worldMatrix * m_Camera.GetWorldViewProjection() };
-		mesh.vertices_out.clear();
-		mesh.vertices_out.reserve(mesh.vertices.size());
+				return vertices_raster;
+			};
 
-		for (const Vertex& v : mesh.vertices)
+		std::vector<std::vector<Vector2>> meshes_raster;
+		for (UntexturedMesh& mesh : meshes_world)
 		{
-			Vertex_Out vertex_out{ Vector4{}, v.uv, v.normal, v.tangent, v.color };
-
-			vertex_out.position = worldViewProjectionMatrix.TransformPoint({ v.position, 1.0f });
-			vertex_out.viewDirection = Vector3{ vertex_out.position.x, vertex_out.position.y, vertex_out.position.z }.Normalized();
-
-			vertex_out.normal = mesh.worldMatrix.TransformVector(v.normal);
-			vertex_out.tangent = mesh.worldMatrix.TransformVector(v.tangent);
-
-
-			const float invVw{ 1 / vertex_out.position.w };
-			vertex_out.position.x *= invVw;
-			vertex_out.position.y *= invVw;
-			vertex_out.position.z *= invVw;
-
-			// emplace back because we made vOut just to store in this vector
-			mesh.vertices_out.emplace_back(vertex_out);
+			meshes_raster.push_back(toRaster(mesh));
 		}
-	}
 
-	void dae::Renderer::RenderMeshTriangle(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, int currStartVertIdx, bool swapVertices) const
-	{
-		const size_t vertIdx0{ mesh.indices[currStartVertIdx + (2 * swapVertices)] };
-		const size_t vertIdx1{ mesh.indices[currStartVertIdx + 1] };
-		const size_t vertIdx2{ mesh.indices[currStartVertIdx + (!swapVertices * 2)] };
+		// Transparent meshes go last, blended over the opaque result
+		const bool renderFireFX{ frame.settings.enableFireFX && !frame.settings.enableDepthBufferVisualisation && !frame.settings.enableBoundingBoxVisualisation };
+		const size_t fireMeshIdx{ static_cast<size_t>(std::distance(m_pMeshes.begin(), std::find(m_pMeshes.begin(), m_pMeshes.end(), m_pFireFX))) };
+		UntexturedMesh fireMesh;
+		std::vector<Vector2> fire_raster;
+		if (renderFireFX)
+		{
+			fireMesh.indices = m_pFireFX->indices;
+			fireMesh.primitiveTopology = m_pFireFX->primitiveTopology;
+			fireMesh.vertices = m_pFireFX->vertices;
+			const MeshTransform& transform{ frame.meshTransforms[fireMeshIdx] };
+			fireMesh.SetTransform(transform.position, transform.rotation, transform.scale);
+			fire_raster = toRaster(fireMesh);
+		}
 
-		// If a triangle has the same vertex twice, it means it has no surface and can't be rendered.
-		if (vertIdx0 == vertIdx1 || vertIdx1 == vertIdx2 || vertIdx2 == vertIdx0)
+		// Screen bounds per mesh, same order as m_pMeshes
+		std::vector<ScreenRect> meshRects(m_pMeshes.size());
+		for (size_t meshIdx{}, opaqueIdx{}; meshIdx < m_pMeshes.size(); ++meshIdx)
 		{
-			return;
+			if (m_pMeshes[meshIdx] != m_pFireFX)
+			{
+				meshRects[meshIdx] = CalculateScreenRect(meshes_raster[opaqueIdx++]);
+			}
+			else if (renderFireFX)
+			{
+				meshRects[meshIdx] = CalculateScreenRect(fire_raster);
+			}
 		}
-		if (m_Camera.ShouldVertexBeClipped(mesh.vertices_out[vertIdx0].position) || m_Camera.ShouldVertexBeClipped(mesh.vertices_out[vertIdx1].position) || m_Camera.ShouldVertexBeClipped(mesh.vertices_out[vertIdx2].position))
+
+		// Only the tiles under the old and the new bounds of what moved
+		if (isFullFrame || m_MeshScreenRects.size() != meshRects.size())
 		{
-			return;
+			std::fill(m_IsTileDirty.begin(), m_IsTileDirty.end(), uint8_t{ 1 });
 		}
+		else
+		{
+			std::fill(m_IsTileDirty.begin(), m_IsTileDirty.end(), uint8_t{ 0 });
+			bool hasCasterMoved{ false };
+			for (size_t meshIdx{}; meshIdx < m_pMeshes.size(); ++meshIdx)
+			{
+				if (!frame.changedMeshes[meshIdx]) continue;
 
-		const Vector2 vert0{ vertices_raster[vertIdx0] };
-		const Vector2 vert1{ vertices_raster[vertIdx1] };
-		const Vector2 vert2{ vertices_raster[vertIdx2] };
+				MarkDirtyTiles(m_MeshScreenRects[meshIdx]);
+				MarkDirtyTiles(meshRects[meshIdx]);
+				hasCasterMoved |= m_pMeshes[meshIdx] != m_pFireFX;
+			}
 
-		// Boundingbox (bb)
-		Vector2 bbTopLeft{ Vector2::Min(vert0,Vector2::Min(vert1,vert2)) };
-		Vector2 bbBotRight{ Vector2::Max(vert0,Vector2::Max(vert1,vert2)) };
+			// A caster that moved changes the shadows on every other opaque mesh as well
+			if (hasCasterMoved && frame.settings.enableShadows)
+			{
+				for (size_t meshIdx{}; meshIdx < m_pMeshes.size(); ++meshIdx)
+				{
+					if (m_pMeshes[meshIdx] != m_pFireFX) MarkDirtyTiles(meshRects[meshIdx]);
+				}
+			}
+		}
+		m_MeshScreenRects = meshRects;
+		m_DirtyTileRatio = static_cast<float>(std::count(m_IsTileDirty.begin(), m_IsTileDirty.end(), uint8_t{ 1 })) / m_IsTileDirty.size();
 
-		const float margin{ 1.f };
-		// Add margin to prevent seethrough lines between quads
+		BeginFrameClear();
+
+		// The bounding boxes aren't shaded, nothing to save there
+		const bool useCheckerboard{ frame.settings.enableCheckerboard && !frame.settings.enableBoundingBoxVisualisation };
+		if (m_PreviousWorldMatrices.size() != meshes_world.size())
 		{
-			const Vector2 marginVect{ margin,margin };
-			bbTopLeft -= marginVect;
-			bbBotRight += marginVect;
+			m_IsHistoryValid = false;
 		}
 
-		// Make sure the boundingbox is on the screen
-		bbTopLeft.x = Clamp(bbTopLeft.x, 0.f, static_cast<float>(m_Width));
-		bbTopLeft.y = Clamp(bbTopLeft.y, 0.f, static_cast<float>(m_Height));
-		bbBotRight.x = Clamp(bbBotRight.x, 0.f, static_cast<float>(m_Width));
-		bbBotRight.y = Clamp(bbBotRight.y, 0.f, static_cast<float>(m_Height));
-
-		const int startX{ static_cast<int>(bbTopLeft.x) };
-		const int endX{ static_cast<int>(bbBotRight.x) };
-		const int startY{ static_cast<int>(bbTopLeft.y) };
-		const int endY{ static_cast<int>(bbBotRight.y) };
+		// +--------------+
+		// | RENDER LOGIC |
+		// +--------------+
+		const Clock::time_point opaqueStartTime{ Clock::now() };
 
-		// For each pixel
-		for (int px{ startX }; px < endX; ++px)
+		m_MeshTileBins.resize(meshes_world.size());
+		for (size_t meshIdx{}; meshIdx < meshes_world.size(); ++meshIdx)
 		{
-			for (int py{ startY }; py < endY; ++py)
+			BinTriangles(meshes_world[meshIdx], meshes_raster[meshIdx], m_MeshTileBins[meshIdx]);
+		}
+
+		// Set before the color pass of every mesh, the reprojection goes through the world matrix of the mesh being shaded
+		const auto updateReprojection = [&](size_t meshIdx)
 			{
-				if (m_EnableBoundingBoxVisualisation)
+				if (useCheckerboard && m_IsHistoryValid)
 				{
-					ColorRGB finalColor{ 1.f,1.f,1.f };
-					//Update Color in Buffer
-
-					m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-						static_cast<uint8_t>(finalColor.r * 255),
-						static_cast<uint8_t>(finalColor.g * 255),
-						static_cast<uint8_t>(finalColor.b * 255));
-					continue;
+					m_ReprojectionMatrix = meshes_world[meshIdx].GetWorldMatrix().Inverse() * m_PreviousWorldMatrices[meshIdx] * m_PreviousViewProjection;
 				}
-
-				const Vector2 currentPixel{ static_cast<float>(px),static_cast<float>(py) };
-				const int pixelIdx{ px + py * m_Width };
-				// Cross products for weights go to waste, optimalisation is possible
-				bool renderTriangle{ false };
-				switch (m_CullingMode)
-				{
-				case dae::CullingMode::Front:
-					renderTriangle = Utils::IsBackFaceHit(currentPixel, vert0, vert1, vert2);
-					break;
-				case dae::CullingMode::Back:
-					renderTriangle = Utils::IsFrontFaceHit(currentPixel, vert0, vert1, vert2);
-					break;
-				case dae::CullingMode::None:
-					renderTriangle = Utils::IsFrontFaceHit(currentPixel, vert0, vert1, vert2);
-					if (!renderTriangle)
-					{
-						renderTriangle = Utils::IsBackFaceHit(currentPixel, vert0, vert1, vert2);
+			};
+
+		// Running average over the last frames, restarted when the strategy changes
+		constexpr float timingSmoothing{ 0.1f };
+		const bool isPrepass{ frame.settings.enableZPrepass && !frame.settings.enableBoundingBoxVisualisation };
+		const float smoothing{ isPrepass == m_OpaquePassTimings.isPrepass ? timingSmoothing : 1.f };
+		m_OpaquePassTimings.isPrepass = isPrepass;
+		if (isPrepass)
+		{
+			// Overdraw between meshes only costs depth, every pixel is shaded by the one mesh that ends up in front
+			for (size_t meshIdx{}; meshIdx < meshes_world.size(); ++meshIdx)
+			{
+				RenderMesh<RasterPass::DepthOnly>(meshes_world[meshIdx], meshes_raster[meshIdx], m_MeshTileBins[meshIdx]);
+			}
+			const Clock::time_point depthEndTime{ Clock::now() };
+			for (size_t meshIdx{}; meshIdx < meshes_world.size(); ++meshIdx)
+			{
+				updateReprojection(meshIdx);
+				RenderMesh<RasterPass::ColorEqualDepth>(meshes_world[meshIdx], meshes_raster[meshIdx], m_MeshTileBins[meshIdx]);
+			}
+
+			const float depthMs{ std::chrono::duration<float, std::milli>(depthEndTime - opaqueStartTime).count() };
+			const float colorMs{ std::chrono::duration<float, std::milli>(Clock::now() - depthEndTime).count() };
+			m_OpaquePassTimings.prepassDepthMs = Lerpf(m_OpaquePassTimings.prepassDepthMs, depthMs, smoothing);
+			m_OpaquePassTimings.prepassColorMs = Lerpf(m_OpaquePassTimings.prepassColorMs, colorMs, smoothing);
+		}
+		else
+		{
+			for (size_t meshIdx{}; meshIdx < meshes_world.size(); ++meshIdx)
+			{
+				updateReprojection(meshIdx);
+				RenderMesh<RasterPass::Color>(meshes_world[meshIdx], meshes_raster[meshIdx], m_MeshTileBins[meshIdx]);
+			}
+
+			const float directMs{ std::chrono::duration<float, std::milli>(Clock::now() - opaqueStartTime).count() };
+			m_OpaquePassTimings.directMs = Lerpf(m_OpaquePassTimings.directMs, directMs, smoothing);
+		}
+
+		// Before the transparency, the fire doesn't move with the vehicle and would smear over it
+		if (useCheckerboard)
+		{
+			ResolveCheckerboard();
+
+			m_PreviousViewProjection = frame.camera.GetWorldViewProjection();
+			m_PreviousWorldMatrices.resize(meshes_world.size());
+			for (size_t meshIdx{}; meshIdx < meshes_world.size(); ++meshIdx)
+			{
+				m_PreviousWorldMatrices[meshIdx] = meshes_world[meshIdx].GetWorldMatrix();
+			}
+			m_IsHistoryValid = true;
+			m_CheckerboardParity ^= 1;
+		}
+		else
+		{
+			m_IsHistoryValid = false;
+		}
+
+		// Measured on the opaque result, the fire shades every pixel anyway
+		if (frame.settings.enableVariableRateShading)
+		{
+			UpdateShadingRates();
+		}
+
+		if (renderFireFX)
+		{
+			RenderTransparentMesh(fireMesh, fire_raster);
+		}
+
+		ResolveTileClears();
+
+		if (frame.settings.enableVariableRateShading)
+		{
+			if (frame.settings.enableShadingRateVisualisation)
+			{
+				VisualizeShadingRates();
+			}
+			m_ShadingRates.swap(m_NextShadingRates);
+		}
+
+		const Clock::time_point renderEndTime{ Clock::now() };
+		if (m_IsUsingInternalBuffer)
+		{
+			UpscaleBackBuffer();
+		}
+		constexpr float upscaleSmoothing{ 0.1f };
+		const float upscaleMs{ std::chrono::duration<float, std::milli>(Clock::now() - renderEndTime).count() };
+		m_ResolutionStats.upscaleMs = Lerpf(m_ResolutionStats.upscaleMs, upscaleMs, upscaleSmoothing);
+		// A partial frame says little about the cost of a full one
+		if (isFullFrame)
+		{
+			UpdateRenderScale(std::chrono::duration<float, std::milli>(renderEndTime - renderStartTime).count());
+		}
+
+		//@END
+		//Unlock BackBuffer
+		SDL_UnlockSurface(m_pBackBuffer);
+
+		// The blit and window update run on the present thread
+		m_pPresenter->Submit(m_pBackBuffer, frame.updateTime);
+	}
+
+	bool dae::Renderer::ResizeRenderTarget() const
+	{
+		// Even sizes, so the pixel quads don't hang over the edge
+		const int width{ m_RenderScale >= 1.f ? m_Width : std::max(static_cast<int>(m_Width * m_RenderScale) & ~1, 2) };
+		const int height{ m_RenderScale >= 1.f ? m_Height : std::max(static_cast<int>(m_Height * m_RenderScale) & ~1, 2) };
+		if (width == m_RenderWidth && height == m_RenderHeight) return false;
+
+		if (m_RenderWidth != 0) ++m_ResolutionStats.resolutionChanges;
+		m_RenderWidth = width;
+		m_RenderHeight = height;
+
+		m_NrTilesX = (m_RenderWidth + m_TileSize - 1) / m_TileSize;
+		m_NrTilesY = (m_RenderHeight + m_TileSize - 1) / m_TileSize;
+		m_IsTileCleared.resize(static_cast<size_t>(m_NrTilesX) * m_NrTilesY);
+		m_IsTileDirty.resize(m_IsTileCleared.size());
+		m_pLightClusters->SetResolution(m_RenderWidth, m_RenderHeight);
+		m_IsHistoryValid = false;
+
+		// Full rate until a frame at the new size has been measured
+		m_NrShadingRateTilesX = (m_RenderWidth + m_ShadingRateTileSize - 1) / m_ShadingRateTileSize;
+		m_NrShadingRateTilesY = (m_RenderHeight + m_ShadingRateTileSize - 1) / m_ShadingRateTileSize;
+		m_ShadingRates.assign(static_cast<size_t>(m_NrShadingRateTilesX) * m_NrShadingRateTilesY, ShadingRate::Rate1x1);
+		m_NextShadingRates.assign(m_ShadingRates.size(), ShadingRate::Rate1x1);
+
+		// Output pixel centers mapped onto the source pixel centers, clamped at the edges
+		m_UpscaleX0.resize(m_Width);
+		m_UpscaleX1.resize(m_Width);
+		m_UpscaleFx.resize(m_Width);
+		const float ratio{ static_cast<float>(m_RenderWidth) / m_Width };
+		for (int x{}; x < m_Width; ++x)
+		{
+			const float sourceX{ Clamp((x + 0.5f) * ratio - 0.5f, 0.f, static_cast<float>(m_RenderWidth - 1)) };
+			const int x0{ static_cast<int>(sourceX) };
+			m_UpscaleX0[x] = static_cast<uint32_t>(x0);
+			m_UpscaleX1[x] = static_cast<uint32_t>(std::min(x0 + 1, m_RenderWidth - 1));
+			m_UpscaleFx[x] = static_cast<uint16_t>((sourceX - x0) * 256.f + 0.5f);
+		}
+		return true;
+	}
+
+	void dae::Renderer::UpdateRenderScale(float renderMs) const
+	{
+		constexpr float timingSmoothing{ 0.1f };
+		m_ResolutionStats.renderMs = Lerpf(m_ResolutionStats.renderMs, renderMs, timingSmoothing);
+		const float megapixels{ static_cast<float>(m_RenderWidth) * m_RenderHeight / 1e6f };
+		m_ResolutionStats.msPerMegapixel = Lerpf(m_ResolutionStats.msPerMegapixel, renderMs / megapixels, timingSmoothing);
+
+		if (!GetRenderFrame().settings.enableDynamicResolution)
+		{
+			m_RenderScale = 1.f;
+			return;
+		}
+		if (m_ResolutionStats.msPerMegapixel <= 0.f) return;
+
+		// The upscale only depends on the window size, the rest of the budget goes to the raster.
+		// Its cost goes with the pixel count, so the scale goes with the square root.
+		const float budgetMs{ std::max(m_TargetFrameMs - m_ResolutionStats.upscaleMs, 0.f) };
+		const float fullMegapixels{ static_cast<float>(m_Width) * m_Height / 1e6f };
+		const float targetScale{ Clamp(sqrtf(budgetMs / (m_ResolutionStats.msPerMegapixel * fullMegapixels)), m_MinRenderScale, 1.f) };
+
+		// Dead band, wider upwards, so noise in the timings doesn't flip between two sizes every frame.
+		// Full scale is always taken when it fits, it's the only scale without an upscale.
+		constexpr float lowerThreshold{ 0.02f };
+		constexpr float raiseThreshold{ 0.05f };
+		if (targetScale < m_RenderScale - lowerThreshold || targetScale > m_RenderScale + raiseThreshold || (targetScale == 1.f && m_RenderScale < 1.f))
+		{
+			m_RenderScale = targetScale;
+		}
+	}
+
+	void dae::Renderer::UpscaleBackBuffer() const
+	{
+		uint32_t* pDestination{ static_cast<uint32_t*>(m_pBackBuffer->pixels) };
+
+		constexpr size_t rowsPerRange{ 16 };
+		if (IsRenderingAtFullScale())
+		{
+			m_pJobSystem->ParallelFor(static_cast<size_t>(m_Height), rowsPerRange, [&](size_t begin, size_t end)
+				{
+					DAE_PROFILE_ZONE("Upscale");
+					std::copy(m_pBackBufferPixels + begin * m_Width, m_pBackBufferPixels + end * m_Width, pDestination + begin * m_Width);
+				});
+			return;
+		}
+
+		const float ratio{ static_cast<float>(m_RenderHeight) / m_Height };
+
+		// Output rows are independent, a few per range
+		m_pJobSystem->ParallelFor(static_cast<size_t>(m_Height), rowsPerRange, [&](size_t begin, size_t end)
+			{
+				DAE_PROFILE_ZONE("Upscale");
+				for (size_t y{ begin }; y < end; ++y)
+				{
+					const float sourceY{ Clamp((y + 0.5f) * ratio - 0.5f, 0.f, static_cast<float>(m_RenderHeight - 1)) };
+					const int y0{ static_cast<int>(sourceY) };
+					const int y1{ std::min(y0 + 1, m_RenderHeight - 1) };
+					const uint32_t fy{ static_cast<uint32_t>((sourceY - y0) * 256.f + 0.5f) };
+
+					SIMD::BilinearRow(m_pBackBufferPixels + y0 * m_RenderWidth, m_pBackBufferPixels + y1 * m_RenderWidth, fy,
+						m_UpscaleX0.data(), m_UpscaleX1.data(), m_UpscaleFx.data(), pDestination + y * m_Width, static_cast<size_t>(m_Width));
+				}
+			});
+	}
+
+	void dae::Renderer::ReprojectPixel(int px, int py, const Vector3& worldPosition) const
+	{
+		const int pixelIdx{ px + py * m_RenderWidth };
+		m_IsHistoryMiss[pixelIdx] = 1;
+		if (!m_IsHistoryValid) return;
+
+		// Same NDC --> Screenspace as the vertices, pixel centers are on whole coordinates
+		const Vector4 previousPosition{ m_ReprojectionMatrix.TransformPoint(worldPosition.x, worldPosition.y, worldPosition.z, 1.f) };
+		if (previousPosition.w <= 0.f) return;
+		const float previousX{ (previousPosition.x / previousPosition.w + 1) / 2.0f * m_RenderWidth };
+		const float previousY{ (1.0f - previousPosition.y / previousPosition.w) / 2.0f * m_RenderHeight };
+		if (previousX < 0.f || previousY < 0.f || previousX > m_RenderWidth - 1.f || previousY > m_RenderHeight - 1.f) return;
+
+		const int x0{ static_cast<int>(previousX) };
+		const int y0{ static_cast<int>(previousY) };
+		const int x1{ std::min(x0 + 1, m_RenderWidth - 1) };
+		const int y1{ std::min(y0 + 1, m_RenderHeight - 1) };
+		const uint32_t fx{ static_cast<uint32_t>((previousX - x0) * 256.f + 0.5f) };
+		const uint32_t fy{ static_cast<uint32_t>((previousY - y0) * 256.f + 0.5f) };
+		const uint32_t* pHistory{ m_HistoryBuffer.data() };
+		m_pBackBufferPixels[pixelIdx] = SIMD::BilinearPixel(pHistory[x0 + y0 * m_RenderWidth], pHistory[x1 + y0 * m_RenderWidth], pHistory[x0 + y1 * m_RenderWidth], pHistory[x1 + y1 * m_RenderWidth], fx, fy);
+		m_IsHistoryMiss[pixelIdx] = 0;
+	}
+
+	void dae::Renderer::ResolveCheckerboard() const
+	{
+		std::atomic<uint32_t> nrReconstructedPixels{};
+		std::atomic<uint32_t> nrHistoryMisses{};
+
+		// Only reads the shaded pixels of the neighbouring tiles, which this pass doesn't write
+		m_pJobSystem->ParallelFor(m_IsTileCleared.size(), 1, [&](size_t begin, size_t end)
+			{
+				DAE_PROFILE_ZONE("Checkerboard resolve");
+				uint32_t reconstructedPixels{};
+				uint32_t historyMisses{};
+				for (size_t tileIdx{ begin }; tileIdx < end; ++tileIdx)
+				{
+					const int tileX{ static_cast<int>(tileIdx) % m_NrTilesX * m_TileSize };
+					const int tileY{ static_cast<int>(tileIdx) / m_NrTilesX * m_TileSize };
+					const int tileWidth{ std::min(m_TileSize, m_RenderWidth - tileX) };
+					const int tileEndY{ std::min(tileY + m_TileSize, m_RenderHeight) };
+
+					// Not rendered this frame, the history still has the opaque result from when it was
+					if (!m_IsTileDirty[tileIdx]) continue;
+
+					// Nothing rendered here, its color is only filled in at the end of the frame
+					if (m_IsTileCleared[tileIdx])
+					{
+						for (int py{ tileY }; py < tileEndY; ++py)
+						{
+							std::fill_n(m_HistoryBuffer.data() + tileX + py * m_RenderWidth, tileWidth, m_ClearColorPixel);
+						}
+						continue;
+					}
+
+					for (int py{ tileY }; py < tileEndY; ++py)
+					{
+						for (int px{ tileX }; px < tileX + tileWidth; ++px)
+						{
+							const int pixelIdx{ px + py * m_RenderWidth };
+							// Shaded this frame, or background which already has the clear color
+							if (IsQuadShaded(px & ~1, py & ~1) || m_pDepthBufferPixels[pixelIdx] == FLT_MAX) continue;
+
+							// Closest shaded pixels, across the quad borders on either side
+							const int qx{ px & ~1 };
+							const int qy{ py & ~1 };
+							const int neighbourPositions[4][2]{ { qx - 1, py }, { qx + 2, py }, { px, qy - 1 }, { px, qy + 2 } };
+							uint32_t neighbours[4]{};
+							int nrNeighbours{};
+							for (const auto& position : neighbourPositions)
+							{
+								const int nx{ position[0] };
+								const int ny{ position[1] };
+								if (nx < 0 || ny < 0 || nx >= m_RenderWidth || ny >= m_RenderHeight) continue;
+
+								const size_t neighbourTileIdx{ static_cast<size_t>(nx / m_TileSize + ny / m_TileSize * m_NrTilesX) };
+								neighbours[nrNeighbours++] = m_IsTileCleared[neighbourTileIdx] ? m_ClearColorPixel : m_pBackBufferPixels[nx + ny * m_RenderWidth];
+							}
+							if (nrNeighbours == 0) continue;
+							// Repeat the ones on screen, they don't change the min, max or (much) the average
+							for (int i{ nrNeighbours }; i < 4; ++i)
+							{
+								neighbours[i] = neighbours[i - nrNeighbours];
+							}
+
+							++reconstructedPixels;
+							if (m_IsHistoryMiss[pixelIdx])
+							{
+								++historyMisses;
+								m_pBackBufferPixels[pixelIdx] = SIMD::AveragePixels(neighbours);
+							}
+							else
+							{
+								m_pBackBufferPixels[pixelIdx] = SIMD::ClampToNeighbourhood(m_pBackBufferPixels[pixelIdx], neighbours);
+							}
+						}
+					}
+
+					for (int py{ tileY }; py < tileEndY; ++py)
+					{
+						std::copy_n(m_pBackBufferPixels + tileX + py * m_RenderWidth, tileWidth, m_HistoryBuffer.data() + tileX + py * m_RenderWidth);
+					}
+				}
+				nrReconstructedPixels += reconstructedPixels;
+				nrHistoryMisses += historyMisses;
+			});
+
+		m_CheckerboardStats = { nrReconstructedPixels.load(), nrHistoryMisses.load() };
+	}
+
+	void dae::Renderer::UpdateShadingRates() const
+	{
+		// Luma range of a tile (8 bit), up to which it shades at that rate
+		constexpr int maxRange4x4{ 6 };
+		constexpr int maxRange2x2{ 20 };
+
+		std::atomic<uint32_t> rateCounts[static_cast<int>(ShadingRate::END)]{};
+		m_pJobSystem->ParallelFor(m_NextShadingRates.size(), m_NrShadingRateTilesX, [&](size_t begin, size_t end)
+			{
+				DAE_PROFILE_ZONE("Shading rates");
+				uint32_t counts[static_cast<int>(ShadingRate::END)]{};
+				for (size_t rateTileIdx{ begin }; rateTileIdx < end; ++rateTileIdx)
+				{
+					const int tileX{ static_cast<int>(rateTileIdx) % m_NrShadingRateTilesX * m_ShadingRateTileSize };
+					const int tileY{ static_cast<int>(rateTileIdx) / m_NrShadingRateTilesX * m_ShadingRateTileSize };
+					const int rasterTileIdx{ tileX / m_TileSize + tileY / m_TileSize * m_NrTilesX };
+
+					// Tiles that aren't rendered this frame keep their rate, their pixels already have the fire blended in
+					ShadingRate rate{ m_ShadingRates[rateTileIdx] };
+					if (m_IsTileDirty[rasterTileIdx])
+					{
+						if (m_IsTileCleared[rasterTileIdx])
+						{
+							// Nothing rendered into it yet, so no contrast either
+							rate = ShadingRate::Rate4x4;
+						}
+						else
+						{
+							// Luma range over the opaque result
+							const int tileEndX{ std::min(tileX + m_ShadingRateTileSize, m_RenderWidth) };
+							const int tileEndY{ std::min(tileY + m_ShadingRateTileSize, m_RenderHeight) };
+							uint32_t minLuma{ 255 };
+							uint32_t maxLuma{};
+							for (int py{ tileY }; py < tileEndY; ++py)
+							{
+								for (int px{ tileX }; px < tileEndX; ++px)
+								{
+									const uint32_t pixel{ m_pBackBufferPixels[px + py * m_RenderWidth] };
+									const uint32_t luma{ (2 * ((pixel >> m_OutputFormat.redShift) & 0xFF) + 5 * ((pixel >> m_OutputFormat.greenShift) & 0xFF) + ((pixel >> m_OutputFormat.blueShift) & 0xFF)) >> 3 };
+									minLuma = std::min(minLuma, luma);
+									maxLuma = std::max(maxLuma, luma);
+								}
+							}
+
+							const int range{ static_cast<int>(maxLuma) - static_cast<int>(minLuma) };
+							rate = range <= maxRange4x4 ? ShadingRate::Rate4x4 : range <= maxRange2x2 ? ShadingRate::Rate2x2 : ShadingRate::Rate1x1;
+						}
+					}
+
+					m_NextShadingRates[rateTileIdx] = rate;
+					++counts[static_cast<int>(rate)];
+				}
+
+				for (int rateIdx{}; rateIdx < static_cast<int>(ShadingRate::END); ++rateIdx)
+				{
+					rateCounts[rateIdx] += counts[rateIdx];
+				}
+			});
+
+		for (int rateIdx{}; rateIdx < static_cast<int>(ShadingRate::END); ++rateIdx)
+		{
+			m_ShadingRateCounts[rateIdx] = rateCounts[rateIdx].load();
+		}
+	}
+
+	void dae::Renderer::VisualizeShadingRates() const
+	{
+		// Same order as ShadingRate
+		const uint32_t tints[static_cast<int>(ShadingRate::END)]{ PackColor(colors::Red), PackColor(colors::Yellow), PackColor(colors::Green) };
+
+		m_pJobSystem->ParallelFor(static_cast<size_t>(m_RenderHeight), m_ShadingRateTileSize, [&](size_t begin, size_t end)
+			{
+				for (int py{ static_cast<int>(begin) }; py < static_cast<int>(end); ++py)
+				{
+					for (int px{}; px < m_RenderWidth; ++px)
+					{
+						// The other tiles were tinted when they were rendered
+						if (!m_IsTileDirty[px / m_TileSize + py / m_TileSize * m_NrTilesX]) continue;
+
+						// Per channel average of the two, rounded down
+						uint32_t& pixel{ m_pBackBufferPixels[px + py * m_RenderWidth] };
+						const uint32_t tint{ tints[static_cast<int>(GetShadingRate(px, py))] };
+						pixel = (pixel & tint) + (((pixel ^ tint) >> 1) & 0x7F7F7F7F);
 					}
-					break;
 				}
-				if (renderTriangle)
+			});
+	}
+
+	Renderer::ScreenRect dae::Renderer::CalculateScreenRect(const std::vector<Vector2>& vertices_raster) const
+	{
+		if (vertices_raster.empty()) return {};
+
+		Vector2 topLeft{ vertices_raster.front() };
+		Vector2 botRight{ vertices_raster.front() };
+		for (const Vector2& v : vertices_raster)
+		{
+			topLeft = Vector2::Min(topLeft, v);
+			botRight = Vector2::Max(botRight, v);
+		}
+
+		// Same margin as the rasterizer, clamped to the screen
+		return {
+			static_cast<int>(Clamp(topLeft.x - 1.f, 0.f, static_cast<float>(m_RenderWidth))),
+			static_cast<int>(Clamp(topLeft.y - 1.f, 0.f, static_cast<float>(m_RenderHeight))),
+			static_cast<int>(Clamp(botRight.x + 2.f, 0.f, static_cast<float>(m_RenderWidth))),
+			static_cast<int>(Clamp(botRight.y + 2.f, 0.f, static_cast<float>(m_RenderHeight)))
+		};
+	}
+
+	void dae::Renderer::MarkDirtyTiles(const ScreenRect& rect) const
+	{
+		if (rect.IsEmpty()) return;
+
+		for (int tileY{ rect.minY / m_TileSize }; tileY <= (rect.maxY - 1) / m_TileSize; ++tileY)
+		{
+			for (int tileX{ rect.minX / m_TileSize }; tileX <= (rect.maxX - 1) / m_TileSize; ++tileX)
+			{
+				m_IsTileDirty[tileX + tileY * m_NrTilesX] = 1;
+			}
+		}
+	}
+
+	void dae::Renderer::BinTriangles(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, TileBins& tileBins) const
+	{
+		DAE_PROFILE_ZONE("Triangle setup + binning");
+		const FrameSnapshot& frame{ GetRenderFrame() };
+		tileBins.resize(m_IsTileDirty.size());
+		for (std::vector<uint32_t>& bin : tileBins)
+		{
+			bin.clear();
+		}
+
+		int nrTriangles{};
+		switch (mesh.primitiveTopology)
+		{
+		case PrimitiveTopology::TriangleList:
+			nrTriangles = static_cast<int>(mesh.indices.size() / 3);
+			break;
+		case PrimitiveTopology::TriangleStrip:
+			nrTriangles = static_cast<int>(mesh.indices.size()) - 2;
+			break;
+		default:
+			std::cout << "PrimitiveTopology not implemented yet\n";
+			return;
+		}
+
+		for (int triangleIdx{}; triangleIdx < nrTriangles; ++triangleIdx)
+		{
+			const int currStartVertIdx{ mesh.primitiveTopology == PrimitiveTopology::TriangleList ? triangleIdx * 3 : triangleIdx };
+			const uint32_t vertIdx0{ mesh.indices[currStartVertIdx] };
+			const uint32_t vertIdx1{ mesh.indices[currStartVertIdx + 1] };
+			const uint32_t vertIdx2{ mesh.indices[currStartVertIdx + 2] };
+
+			// If a triangle has the same vertex twice, it means it has no surface and can't be rendered.
+			if (vertIdx0 == vertIdx1 || vertIdx1 == vertIdx2 || vertIdx2 == vertIdx0)
+			{
+				continue;
+			}
+			if (frame.camera.ShouldVertexBeClipped(mesh.vertices_out[vertIdx0].position) || frame.camera.ShouldVertexBeClipped(mesh.vertices_out[vertIdx1].position) || frame.camera.ShouldVertexBeClipped(mesh.vertices_out[vertIdx2].position))
+			{
+				continue;
+			}
+
+			// Same bounding box as RenderMeshTriangle, margin included
+			const Vector2& vert0{ vertices_raster[vertIdx0] };
+			const Vector2& vert1{ vertices_raster[vertIdx1] };
+			const Vector2& vert2{ vertices_raster[vertIdx2] };
+			const Vector2 bbTopLeft{ Vector2::Min(vert0,Vector2::Min(vert1,vert2)) };
+			const Vector2 bbBotRight{ Vector2::Max(vert0,Vector2::Max(vert1,vert2)) };
+
+			const int startX{ static_cast<int>(Clamp(bbTopLeft.x - 1.f, 0.f, static_cast<float>(m_RenderWidth))) };
+			const int startY{ static_cast<int>(Clamp(bbTopLeft.y - 1.f, 0.f, static_cast<float>(m_RenderHeight))) };
+			const int endX{ static_cast<int>(Clamp(bbBotRight.x + 1.f, 0.f, static_cast<float>(m_RenderWidth))) };
+			const int endY{ static_cast<int>(Clamp(bbBotRight.y + 1.f, 0.f, static_cast<float>(m_RenderHeight))) };
+			if (startX >= endX || startY >= endY) continue;
+
+			for (int tileY{ startY / m_TileSize }; tileY <= (endY - 1) / m_TileSize; ++tileY)
+			{
+				for (int tileX{ startX / m_TileSize }; tileX <= (endX - 1) / m_TileSize; ++tileX)
+				{
+					const int tileIdx{ tileX + tileY * m_NrTilesX };
+					if (m_IsTileDirty[tileIdx]) tileBins[tileIdx].push_back(static_cast<uint32_t>(currStartVertIdx));
+				}
+			}
+		}
+	}
+
+	void dae::Renderer::BeginFrameClear() const
+	{
+		const bool enableUniformClearColor{ GetRenderFrame().settings.enableUniformClearColor };
+		m_ClearColorPixel = PackColor(enableUniformClearColor ? m_UniformClearColor : m_SoftwareClearColor);
+		// Tiles that aren't rendered this frame keep what they have
+		std::copy(m_IsTileDirty.begin(), m_IsTileDirty.end(), m_IsTileCleared.begin());
+	}
+
+	void dae::Renderer::MaterializeTileClear(size_t tileIdx) const
+	{
+		if (!m_IsTileCleared[tileIdx]) return;
+		m_IsTileCleared[tileIdx] = 0;
+
+		const int tileX{ static_cast<int>(tileIdx) % m_NrTilesX * m_TileSize };
+		const int tileY{ static_cast<int>(tileIdx) / m_NrTilesX * m_TileSize };
+		const int tileWidth{ std::min(m_TileSize, m_RenderWidth - tileX) };
+		const int tileEndY{ std::min(tileY + m_TileSize, m_RenderHeight) };
+		for (int py{ tileY }; py < tileEndY; ++py)
+		{
+			std::fill_n(m_pDepthBufferPixels + tileX + py * m_RenderWidth, tileWidth, FLT_MAX);
+			std::fill_n(m_pBackBufferPixels + tileX + py * m_RenderWidth, tileWidth, m_ClearColorPixel);
+		}
+	}
+
+	void dae::Renderer::ResolveTileClears() const
+	{
+		// Nothing reads the depth of these tiles anymore, only the color is needed for the present
+		m_pJobSystem->ParallelFor(m_IsTileCleared.size(), m_NrTilesX, [&](size_t begin, size_t end)
+			{
+				DAE_PROFILE_ZONE("Clear");
+				for (size_t tileIdx{ begin }; tileIdx < end; ++tileIdx)
 				{
+					if (!m_IsTileCleared[tileIdx]) continue;
+
+					const int tileX{ static_cast<int>(tileIdx) % m_NrTilesX * m_TileSize };
+					const int tileY{ static_cast<int>(tileIdx) / m_NrTilesX * m_TileSize };
+					const int tileWidth{ std::min(m_TileSize, m_RenderWidth - tileX) };
+					const int tileEndY{ std::min(tileY + m_TileSize, m_RenderHeight) };
+					for (int py{ tileY }; py < tileEndY; ++py)
+					{
+						SIMD::StreamFill(m_pBackBufferPixels + tileX + py * m_RenderWidth, tileWidth, m_ClearColorPixel);
+					}
+				}
+				SIMD::StreamFence();
+			});
+	}
+
+	template<Renderer::RasterPass rasterPass>
+	void dae::Renderer::RenderMesh(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, const TileBins& tileBins) const
+	{
+		// One tile per range, the tiles differ a lot in cost so they're handed out one by one
+		m_pJobSystem->ParallelFor(tileBins.size(), 1, [&](size_t begin, size_t end)
+			{
+				DAE_PROFILE_ZONE(rasterPass == RasterPass::DepthOnly ? "Raster depth" : "Raster + shading");
+				for (size_t tileIdx{ begin }; tileIdx < end; ++tileIdx)
+				{
+					if (tileBins[tileIdx].empty()) continue;
+					MaterializeTileClear(tileIdx);
+
+					const int tileX{ static_cast<int>(tileIdx) % m_NrTilesX * m_TileSize };
+					const int tileY{ static_cast<int>(tileIdx) / m_NrTilesX * m_TileSize };
+					for (const uint32_t currStartVertIdx : tileBins[tileIdx])
+					{
+						RenderMeshTriangle<rasterPass>(mesh, vertices_raster, currStartVertIdx, tileX, tileY);
+					}
+				}
+			});
+	}
+
+	void dae::Renderer::VertexTransformationFunction(UntexturedMesh& mesh) const
+	{
+		const FrameSnapshot& frame{ GetRenderFrame() };
+		const AffineTransform& worldMatrix{ mesh.GetWorldMatrix() };
+		const Matrix worldViewProjectionMatrix{ worldMatrix * frame.camera.GetWorldViewProjection() };
+
+		const size_t nrVertices{ mesh.vertices.size() };
+		mesh.vertices_out.resize(nrVertices);
+
+		m_pJobSystem->ParallelFor(nrVertices, m_VertexBatchSize, [&](size_t begin, size_t end)
+			{
+				DAE_PROFILE_ZONE("Vertex transform");
+				// Gather the attributes so they're transformed in batches
+				const size_t count{ end - begin };
+				std::vector<Vector3> positions(count);
+				std::vector<Vector3> normals(count);
+				std::vector<Vector3> tangents(count);
+				for (size_t i{}; i < count; ++i)
+				{
+					positions[i] = mesh.vertices[begin + i].position;
+					normals[i] = mesh.vertices[begin + i].normal;
+					tangents[i] = mesh.vertices[begin + i].tangent;
+				}
+
+				std::vector<Vector4> clipPositions(count);
+				std::vector<Vector3> worldPositions(count);
+				worldViewProjectionMatrix.TransformPoints(positions, clipPositions);
+				worldMatrix.TransformPoints(positions, worldPositions);
+				worldMatrix.TransformVectors(normals, normals);
+				worldMatrix.TransformVectors(tangents, tangents);
+
+				for (size_t i{}; i < count; ++i)
+				{
+					const Vertex& v{ mesh.vertices[begin + i] };
+					Vertex_Out vertex_out{ clipPositions[i], v.uv, normals[i], tangents[i], v.color };
+
+					vertex_out.viewDirection = Vector3{ vertex_out.position.x, vertex_out.position.y, vertex_out.position.z }.Normalized();
+					vertex_out.worldPosition = worldPositions[i];
+
+
+					const float invVw{ 1 / vertex_out.position.w };
+					vertex_out.position.x *= invVw;
+					vertex_out.position.y *= invVw;
+					vertex_out.position.z *= invVw;
+
+					mesh.vertices_out[begin + i] = vertex_out;
+				}
+			});
+	}
+
+	template<Renderer::RasterPass rasterPass>
+	void dae::Renderer::RenderMeshTriangle(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, int currStartVertIdx, int tileX, int tileY) const
+	{
+		const FrameSnapshot& frame{ GetRenderFrame() };
+		// Every other triangle of a strip has its winding flipped.
+		// Degenerate and clipped triangles were already skipped by BinTriangles.
+		const bool swapVertices{ mesh.primitiveTopology == PrimitiveTopology::TriangleStrip && currStartVertIdx % 2 };
+		const size_t vertIdx0{ mesh.indices[currStartVertIdx + (2 * swapVertices)] };
+		const size_t vertIdx1{ mesh.indices[currStartVertIdx + 1] };
+		const size_t vertIdx2{ mesh.indices[currStartVertIdx + (!swapVertices * 2)] };
+
+		const Vector2 vert0{ vertices_raster[vertIdx0] };
+		const Vector2 vert1{ vertices_raster[vertIdx1] };
+		const Vector2 vert2{ vertices_raster[vertIdx2] };
+
+		// Boundingbox (bb)
+		Vector2 bbTopLeft{ Vector2::Min(vert0,Vector2::Min(vert1,vert2)) };
+		Vector2 bbBotRight{ Vector2::Max(vert0,Vector2::Max(vert1,vert2)) };
+
+		const float margin{ 1.f };
+		// Add margin to prevent seethrough lines between quads
+		{
+			const Vector2 marginVect{ margin,margin };
+			bbTopLeft -= marginVect;
+			bbBotRight += marginVect;
+		}
+
+		// Make sure the boundingbox is on the screen
+		bbTopLeft.x = Clamp(bbTopLeft.x, 0.f, static_cast<float>(m_RenderWidth));
+		bbTopLeft.y = Clamp(bbTopLeft.y, 0.f, static_cast<float>(m_RenderHeight));
+		bbBotRight.x = Clamp(bbBotRight.x, 0.f, static_cast<float>(m_RenderWidth));
+		bbBotRight.y = Clamp(bbBotRight.y, 0.f, static_cast<float>(m_RenderHeight));
+
+		// And inside the tile
+		const int startX{ std::max(static_cast<int>(bbTopLeft.x), tileX) };
+		const int endX{ std::min(static_cast<int>(bbBotRight.x), tileX + m_TileSize) };
+		const int startY{ std::max(static_cast<int>(bbTopLeft.y), tileY) };
+		const int endY{ std::min(static_cast<int>(bbBotRight.y), tileY + m_TileSize) };
+		if (startX >= endX || startY >= endY) return;
+
+		if (rasterPass == RasterPass::Color && frame.settings.enableBoundingBoxVisualisation)
+		{
+			const uint32_t white{ PackColor(colors::White) };
+			for (int py{ startY }; py < endY; ++py)
+			{
+				std::fill_n(m_pBackBufferPixels + startX + py * m_RenderWidth, endX - startX, white);
+			}
+			return;
+		}
+
+		// divide by total triangle area
+		const float totalTriangleArea{ Vector2::Cross(vert1 - vert0,vert2 - vert0) };
+		const float invTotalTriangleArea{ 1 / totalTriangleArea };
+
+		const Vertex_Out& vertOut0{ mesh.vertices_out[vertIdx0] };
+		const Vertex_Out& vertOut1{ mesh.vertices_out[vertIdx1] };
+		const Vertex_Out& vertOut2{ mesh.vertices_out[vertIdx2] };
+		const float depth0{ vertOut0.position.z };
+		const float depth1{ vertOut1.position.z };
+		const float depth2{ vertOut2.position.z };
+		const float w0{ vertOut0.position.w };
+		const float w1{ vertOut1.position.w };
+		const float w2{ vertOut2.position.w };
+
+		// Packed color of the 4x4 shading blocks in the current block row, the triangle is clamped to one tile
+		uint32_t blockPixels[m_TileSize / 4]{};
+		bool isBlockShaded[m_TileSize / 4]{};
+		int blockRow{ -1 };
+
+		// For each 2x2 quad, aligned to even pixels so neighbouring triangles agree on the quads.
+		// Lanes that aren't covered are still interpolated as helpers, the quad needs all 4 for its uv derivatives.
+		for (int qy{ startY & ~1 }; qy < endY; qy += 2)
+		{
+			if ((qy >> 2) != blockRow)
+			{
+				blockRow = qy >> 2;
+				std::fill(std::begin(isBlockShaded), std::end(isBlockShaded), false);
+			}
+
+			for (int qx{ startX & ~1 }; qx < endX; qx += 2)
+			{
+				PixelQuad quad{};
+				float weights[PixelQuad::LaneCount][3]{};
+				float interpolatedDepths[PixelQuad::LaneCount]{};
+
+				for (int lane{}; lane < PixelQuad::LaneCount; ++lane)
+				{
+					const int px{ qx + (lane & 1) };
+					const int py{ qy + (lane >> 1) };
+					const Vector2 currentPixel{ static_cast<float>(px),static_cast<float>(py) };
 
 					// weights
-					float weight0, weight1, weight2;
-					weight0 = Vector2::Cross((currentPixel - vert1), (vert1 - vert2));
-					weight1 = Vector2::Cross((currentPixel - vert2), (vert2 - vert0));
-					weight2 = Vector2::Cross((currentPixel - vert0), (vert0 - vert1));
-					// divide by total triangle area
-					const float totalTriangleArea{ Vector2::Cross(vert1 - vert0,vert2 - vert0) };
-					const float invTotalTriangleArea{ 1 / totalTriangleArea };
-					weight0 *= invTotalTriangleArea;
-					weight1 *= invTotalTriangleArea;
-					weight2 *= invTotalTriangleArea;
-
-					const float depth0{ mesh.vertices_out[vertIdx0].position.z };
-					const float depth1{ mesh.vertices_out[vertIdx1].position.z };
-					const float depth2{ mesh.vertices_out[vertIdx2].position.z };
+					float& weight0{ weights[lane][0] };
+					float& weight1{ weights[lane][1] };
+					float& weight2{ weights[lane][2] };
+					weight0 = Vector2::Cross((currentPixel - vert1), (vert1 - vert2)) * invTotalTriangleArea;
+					weight1 = Vector2::Cross((currentPixel - vert2), (vert2 - vert0)) * invTotalTriangleArea;
+					weight2 = Vector2::Cross((currentPixel - vert0), (vert0 - vert1)) * invTotalTriangleArea;
+
 					const float interpolatedDepth{ 1.f / (weight0 * (1.f / depth0) + weight1 * (1.f / depth1) + weight2 * (1.f / depth2)) };
-					if (m_pDepthBufferPixels[pixelIdx] < interpolatedDepth || interpolatedDepth < 0.f || interpolatedDepth > 1.f) continue;
+					interpolatedDepths[lane] = interpolatedDepth;
 
-					m_pDepthBufferPixels[pixelIdx] = interpolatedDepth;
+					if (px < startX || px >= endX || py < startY || py >= endY) continue;
 
-					Vertex_Out pixel{};
-					pixel.position = { currentPixel.x,currentPixel.y, interpolatedDepth,interpolatedDepth };
+					// Cross products for weights go to waste, optimalisation is possible
+					bool renderTriangle{ false };
+					switch (frame.settings.cullingMode)
+					{
+					case dae::CullingMode::Front:
+						renderTriangle = Utils::IsBackFaceHit(currentPixel, vert0, vert1, vert2);
+						break;
+					case dae::CullingMode::Back:
+						renderTriangle = Utils::IsFrontFaceHit(currentPixel, vert0, vert1, vert2);
+						break;
+					case dae::CullingMode::None:
+						renderTriangle = Utils::IsFrontFaceHit(currentPixel, vert0, vert1, vert2);
+						if (!renderTriangle)
+						{
+							renderTriangle = Utils::IsBackFaceHit(currentPixel, vert0, vert1, vert2);
+						}
+						break;
+					}
+					if (!renderTriangle) continue;
+
+					const int pixelIdx{ px + py * m_RenderWidth };
+					if (interpolatedDepth < 0.f || interpolatedDepth > 1.f) continue;
+
+					if constexpr (rasterPass == RasterPass::ColorEqualDepth)
+					{
+						// Same computation as the depth pass, so the surviving fragment matches exactly
+						if (m_pDepthBufferPixels[pixelIdx] != interpolatedDepth) continue;
+					}
+					else
+					{
+						if (m_pDepthBufferPixels[pixelIdx] < interpolatedDepth) continue;
+
+						m_pDepthBufferPixels[pixelIdx] = interpolatedDepth;
+					}
+
+					quad.coverageMask |= 1u << lane;
+				}
+
+				if constexpr (rasterPass == RasterPass::DepthOnly) continue;
+				if (quad.coverageMask == 0) continue;
+
+				if (frame.settings.enableCheckerboard && !IsQuadShaded(qx, qy))
+				{
+					for (int lane{}; lane < PixelQuad::LaneCount; ++lane)
+					{
+						if (!(quad.coverageMask & (1u << lane))) continue;
+
+						const float weight0{ weights[lane][0] };
+						const float weight1{ weights[lane][1] };
+						const float weight2{ weights[lane][2] };
+						const float interpolatedW{ 1.f / (weight0 / w0 + weight1 / w1 + weight2 / w2) };
+						const Vector3 worldPosition{ interpolatedW * (weight0 * vertOut0.worldPosition / w0 + weight1 * vertOut1.worldPosition / w1 + weight2 * vertOut2.worldPosition / w2) };
+						ReprojectPixel(qx + (lane & 1), qy + (lane >> 1), worldPosition);
+					}
+					continue;
+				}
+
+				// A coarse quad only shades its first covered lane, the other covered lanes get the same color
+				const ShadingRate shadingRate{ frame.settings.enableVariableRateShading ? GetShadingRate(qx, qy) : ShadingRate::Rate1x1 };
+				const uint32_t coverageMask{ quad.coverageMask };
+				const int blockIdx{ (qx >> 2) - (tileX >> 2) };
+				auto broadcastPixel = [&](uint32_t pixel)
+					{
+						for (int lane{}; lane < PixelQuad::LaneCount; ++lane)
+						{
+							if (coverageMask & (1u << lane)) m_pBackBufferPixels[qx + (lane & 1) + (qy + (lane >> 1)) * m_RenderWidth] = pixel;
+						}
+					};
+				if (shadingRate == ShadingRate::Rate4x4 && isBlockShaded[blockIdx])
+				{
+					broadcastPixel(blockPixels[blockIdx]);
+					continue;
+				}
+				const int shadedLane{ std::countr_zero(coverageMask) };
+				if (shadingRate != ShadingRate::Rate1x1)
+				{
+					quad.coverageMask = 1u << shadedLane;
+				}
+
+				for (int lane{}; lane < PixelQuad::LaneCount; ++lane)
+				{
+					const float weight0{ weights[lane][0] };
+					const float weight1{ weights[lane][1] };
+					const float weight2{ weights[lane][2] };
+					const float interpolatedDepth{ interpolatedDepths[lane] };
+
+					Vertex_Out& pixel{ quad.fragments[lane] };
+					// w keeps the perspective correct view space depth, used for the light clusters
+					const float interpolatedW{ 1.f / (weight0 / w0 + weight1 / w1 + weight2 / w2) };
+
+					pixel.position = { static_cast<float>(qx + (lane & 1)), static_cast<float>(qy + (lane >> 1)), interpolatedDepth, interpolatedW };
 					pixel.uv = interpolatedDepth * ((weight0 * mesh.vertices[vertIdx0].uv) / depth0 + (weight1 * mesh.vertices[vertIdx1].uv) / depth1 + (weight2 * mesh.vertices[vertIdx2].uv) / depth2);
-					pixel.normal = Vector3{ interpolatedDepth * (weight0 * mesh.vertices_out[vertIdx0].normal / mesh.vertices_out[vertIdx0].position.w + weight1 * mesh.vertices_out[vertIdx1].normal / mesh.vertices_out[vertIdx1].position.w + weight2 * mesh.vertices_out[vertIdx2].normal / mesh.vertices_out[vertIdx2].position.w) }.Normalized();
-					pixel.tangent = Vector3{ interpolatedDepth * (weight0 * mesh.vertices_out[vertIdx0].tangent / mesh.vertices_out[vertIdx0].position.w + weight1 * mesh.vertices_out[vertIdx1].tangent / mesh.vertices_out[vertIdx1].position.w + weight2 * mesh.vertices_out[vertIdx2].tangent / mesh.vertices_out[vertIdx2].position.w) }.Normalized();
-					pixel.viewDirection = Vector3{ interpolatedDepth * (weight0 * mesh.vertices_out[vertIdx0].viewDirection / mesh.vertices_out[vertIdx0].position.w + weight1 * mesh.vertices_out[vertIdx1].viewDirection / mesh.vertices_out[vertIdx1].position.w + weight2 * mesh.vertices_out[vertIdx2].viewDirection / mesh.vertices_out[vertIdx2].position.w) }.Normalized();
 
-					PixelShading(pixel);
+					// Helper lanes only need the uv
+					if (!(quad.coverageMask & (1u << lane))) continue;
+
+					pixel.normal = Vector3{ interpolatedDepth * (weight0 * vertOut0.normal / w0 + weight1 * vertOut1.normal / w1 + weight2 * vertOut2.normal / w2) }.Normalized();
+					pixel.tangent = Vector3{ interpolatedDepth * (weight0 * vertOut0.tangent / w0 + weight1 * vertOut1.tangent / w1 + weight2 * vertOut2.tangent / w2) }.Normalized();
+					pixel.viewDirection = Vector3{ interpolatedDepth * (weight0 * vertOut0.viewDirection / w0 + weight1 * vertOut1.viewDirection / w1 + weight2 * vertOut2.viewDirection / w2) }.Normalized();
+					if (frame.settings.enableLocalLights || frame.settings.enableShadows)
+					{
+						pixel.worldPosition = interpolatedW * (weight0 * vertOut0.worldPosition / w0 + weight1 * vertOut1.worldPosition / w1 + weight2 * vertOut2.worldPosition / w2);
+					}
+				}
+
+				// Finite differences within the quad
+				quad.uvDdx = quad.fragments[1].uv - quad.fragments[0].uv;
+				quad.uvDdy = quad.fragments[2].uv - quad.fragments[0].uv;
+
+				// The shaded fragment stands in for a larger footprint, so it needs a blurrier mip
+				const float footprint{ shadingRate == ShadingRate::Rate4x4 ? 4.f : shadingRate == ShadingRate::Rate2x2 ? 2.f : 1.f };
+				quad.uvDdx *= footprint;
+				quad.uvDdy *= footprint;
+
+				(this->*m_pPixelShader)(quad);
+
+				if (shadingRate != ShadingRate::Rate1x1)
+				{
+					const uint32_t pixel{ m_pBackBufferPixels[qx + (shadedLane & 1) + (qy + (shadedLane >> 1)) * m_RenderWidth] };
+					broadcastPixel(pixel);
+					if (shadingRate == ShadingRate::Rate4x4)
+					{
+						blockPixels[blockIdx] = pixel;
+						isBlockShaded[blockIdx] = true;
+					}
 				}
 			}
 		}
 	}
 
-	void dae::Renderer::PixelShading(const Vertex_Out& v) const
+	Renderer::PixelShaderFunction Renderer::SelectPixelShader() const
 	{
-		Vector3 normal{ v.normal };
+		const FrameSnapshot& frame{ GetRenderFrame() };
+		// [shadingMode][useNormalMap]
+		static constexpr PixelShaderFunction pixelShaders[static_cast<int>(ShadingMode::END)][2]
+		{
+			{ &Renderer::PixelShading<ShadingMode::ObservedArea, false>, &Renderer::PixelShading<ShadingMode::ObservedArea, true> },
+			{ &Renderer::PixelShading<ShadingMode::Diffuse, false>, &Renderer::PixelShading<ShadingMode::Diffuse, true> },
+			{ &Renderer::PixelShading<ShadingMode::Specular, false>, &Renderer::PixelShading<ShadingMode::Specular, true> },
+			{ &Renderer::PixelShading<ShadingMode::Combined, false>, &Renderer::PixelShading<ShadingMode::Combined, true> }
+		};
 
-		ColorRGB finalColor{};
+		if (frame.settings.enableDepthBufferVisualisation)
+		{
+			return &Renderer::PixelShadingDepth;
+		}
+		return pixelShaders[static_cast<int>(frame.settings.shadingMode)][frame.settings.enableNormalMap];
+	}
+
+	template<Renderer::ShadingMode shadingMode, bool useNormalMap>
+	void dae::Renderer::PixelShading(const PixelQuad& quad) const
+	{
+		const FrameSnapshot& frame{ GetRenderFrame() };
+		static_assert(PixelQuad::LaneCount == BRDF::BatchSize, "The lighting batch maps onto the quad lanes");
+
+		ColorRGB finalColors[PixelQuad::LaneCount]{};
 
-		if (m_EnableNormalMap)
+		if constexpr (shadingMode == ShadingMode::Diffuse)
+		{
+			// Diffuse doesn't use the normal at all
+			const Texture* pDiffuseTexture{ m_pVehicleDiffuseTexture->Get() };
+			const int diffuseMip{ pDiffuseTexture->CalculateMip(quad.uvDdx, quad.uvDdy) };
+			for (int i{}; i < PixelQuad::LaneCount; ++i)
+			{
+				if (!quad.IsCovered(i)) continue;
+				finalColors[i] = pDiffuseTexture->SampleLevel(quad.fragments[i].uv, diffuseMip);
+			}
+		}
+		else
 		{
-			const Vector3 binormal = Vector3::Cross(v.normal, v.tangent);
-			const Matrix tangentSpaceAxis = Matrix{ v.tangent,binormal,v.normal,Vector3::Zero };
+			// One mip per texture for the whole quad
+			const Texture* pNormalTexture{ m_pVehicleNormalTexture->Get() };
+			const Texture* pSpecularTexture{ m_pVehicleSpecularTexture->Get() };
+			const Texture* pGlossinessTexture{ m_pVehicleGlossinessTexture->Get() };
+			const Texture* pDiffuseTexture{ m_pVehicleDiffuseTexture->Get() };
+			const int normalMip{ useNormalMap ? pNormalTexture->CalculateMip(quad.uvDdx, quad.uvDdy) : 0 };
+			const int specularMip{ shadingMode != ShadingMode::ObservedArea ? pSpecularTexture->CalculateMip(quad.uvDdx, quad.uvDdy) : 0 };
+			const int glossinessMip{ shadingMode != ShadingMode::ObservedArea ? pGlossinessTexture->CalculateMip(quad.uvDdx, quad.uvDdy) : 0 };
+			const int diffuseMip{ shadingMode == ShadingMode::Combined ? pDiffuseTexture->CalculateMip(quad.uvDdx, quad.uvDdy) : 0 };
+
+			// Helper lanes keep a zero normal and come out black, they're never written
+			BRDF::FragmentBatch batch{};
+			ColorRGB diffuse[PixelQuad::LaneCount]{};
+			ColorRGB specularColor[PixelQuad::LaneCount]{};
+			float shadow[PixelQuad::LaneCount]{ 1.f, 1.f, 1.f, 1.f };
+
+			for (int i{}; i < PixelQuad::LaneCount; ++i)
+			{
+				if (!quad.IsCovered(i)) continue;
+
+				const Vertex_Out& v{ quad.fragments[i] };
+
+				if (frame.settings.enableShadows)
+				{
+					// Offset along the geometric normal, the normal map would make the bias noisy
+					shadow[i] = m_pShadowMap->GetVisibility(v.worldPosition, v.normal);
+				}
+
+				Vector3 normal{ v.normal };
+				if constexpr (useNormalMap)
+				{
+					const Vector3 binormal = Vector3::Cross(v.normal, v.tangent);
+					const Matrix tangentSpaceAxis = Matrix{ v.tangent,binormal,v.normal,Vector3::Zero };
+
+					const ColorRGB normalSampleVecCol{ (2 * pNormalTexture->SampleLevel(v.uv, normalMip)) - ColorRGB{1,1,1} };
+					const Vector3 normalSampleVec{ normalSampleVecCol.r,normalSampleVecCol.g,normalSampleVecCol.b };
+					normal = tangentSpaceAxis.TransformVector(normalSampleVec).Normalized();
+				}
+
+				if constexpr (shadingMode == ShadingMode::ObservedArea)
+				{
+					// m_GlobalLight.direction is normalized on construction
+					const float observedArea{ shadow[i] * Vector3::DotClamp(normal, -m_GlobalLight.direction) };
+					finalColors[i] = ColorRGB{ observedArea, observedArea, observedArea };
+					continue;
+				}
+
+				batch.normalX[i] = normal.x;
+				batch.normalY[i] = normal.y;
+				batch.normalZ[i] = normal.z;
+				batch.viewX[i] = v.viewDirection.x;
+				batch.viewY[i] = v.viewDirection.y;
+				batch.viewZ[i] = v.viewDirection.z;
+
+				batch.exponent[i] = m_SpecularShininess * pGlossinessTexture->SampleLevel(v.uv, glossinessMip).r;
+				specularColor[i] = pSpecularTexture->SampleLevel(v.uv, specularMip);
+				if constexpr (shadingMode == ShadingMode::Combined)
+				{
+					diffuse[i] = pDiffuseTexture->SampleLevel(v.uv, diffuseMip);
+				}
+			}
+
+			if constexpr (shadingMode != ShadingMode::ObservedArea)
+			{
+				BRDF::FragmentBatchLighting lighting{};
+				BRDF::PhongLambert(-m_GlobalLight.direction, batch, lighting);
+
+				for (int i{}; i < PixelQuad::LaneCount; ++i)
+				{
+					const float observedArea{ shadow[i] * lighting.observedArea[i] };
+
+					if constexpr (shadingMode == ShadingMode::Specular)
+					{
+						finalColors[i] = specularColor[i] * lighting.phong[i] * observedArea;
+					}
+					else
+					{
+						const ColorRGB lambert{ BRDF::Lambert(1.0f, diffuse[i]) };
+						finalColors[i] = diffuse[i] + m_GlobalLight.intensity * observedArea * lambert + shadow[i] * specularColor[i] * lighting.phong[i];
+
+						if (frame.settings.enableLocalLights && quad.IsCovered(i))
+						{
+							const Vector3 normal{ batch.normalX[i], batch.normalY[i], batch.normalZ[i] };
+							finalColors[i] += ShadeLocalLights(quad.fragments[i], normal, lambert, specularColor[i], batch.exponent[i]);
+						}
+					}
+				}
+			}
+		}
 
-			const ColorRGB normalSampleVecCol{ (2 * m_pVehicleNormalTexture->Sample(v.uv)) - ColorRGB{1,1,1} };
-			const Vector3 normalSampleVec{ normalSampleVecCol.r,normalSampleVecCol.g,normalSampleVecCol.b };
-			normal = tangentSpaceAxis.TransformVector(normalSampleVec);
+		for (int i{}; i < PixelQuad::LaneCount; ++i)
+		{
+			finalColors[i] += m_AmbientColor;
 		}
 
-		if (!m_EnableDepthBufferVisualisation)
+		WritePixels(quad, finalColors);
+	}
+
+	ColorRGB dae::Renderer::ShadeLocalLights(const Vertex_Out& v, const Vector3& normal, const ColorRGB& lambert, const ColorRGB& specularColor, float exponent) const
+	{
+		ColorRGB color{};
+
+		const LightClusters::LightRange lights{ m_pLightClusters->GetLights(static_cast<int>(v.position.x), static_cast<int>(v.position.y), v.position.w) };
+		for (uint32_t i{}; i < lights.count; ++i)
 		{
-			const float observedArea{ Vector3::DotClamp(normal.Normalized(), -m_GlobalLight.direction.Normalized()) };
-			finalColor = m_pVehicleDiffuseTexture->Sample(v.uv);
-			const ColorRGB lambert{ BRDF::Lambert(1.0f, m_pVehicleDiffuseTexture->Sample(v.uv)) };
-			const float specularVal{ m_SpecularShininess * m_pVehicleGlossinessTexture->Sample(v.uv).r };
-			const ColorRGB specular{ m_pVehicleSpecularTexture->Sample(v.uv) * BRDF::Phong(1.0f, specularVal, -m_GlobalLight.direction, v.viewDirection, normal) };
+			const LocalLight& light{ m_Lights[lights.pLightIndices[i]] };
+
+			Vector3 toLight{ light.position - v.worldPosition };
+			const float sqrDistance{ toLight.SqrMagnitude() };
+			if (sqrDistance >= light.range * light.range) continue;
+
+			const float distance{ sqrtf(sqrDistance) };
+			toLight /= distance;
 
-			// += since finalColor is already a sample of the diffuse texture
-			switch (m_ShadingMode)
+			const float observedArea{ Vector3::DotClamp(normal, toLight) };
+			if (observedArea <= 0.f) continue;
+
+			// Inverse square falloff, windowed to reach zero at the range
+			const float window{ Saturate(1.f - Square(Square(distance / light.range))) };
+			float attenuation{ Square(window) / (sqrDistance + 1.f) };
+
+			if (light.type == LightType::Spot)
 			{
-			case dae::Renderer::ShadingMode::ObservedArea:
-				finalColor = ColorRGB{ observedArea, observedArea, observedArea };
-				break;
-			case dae::Renderer::ShadingMode::Diffuse:
-				break;
-			case dae::Renderer::ShadingMode::Specular:
-				finalColor = specular * observedArea;
-				break;
-			case dae::Renderer::ShadingMode::Combined:
-				finalColor += m_GlobalLight.intensity * observedArea * lambert + specular;
-				break;
+				const float cosAngle{ Vector3::Dot(-toLight, light.direction) };
+				attenuation *= Saturate((cosAngle - light.cosOuterCone) / (light.cosInnerCone - light.cosOuterCone));
 			}
 
-			finalColor += m_AmbientColor;
+			const float alfa{ Vector3::DotClamp(Vector3::Reflect(toLight, normal), v.viewDirection) };
+			const float phong{ alfa > 0.f ? FastPow(alfa, exponent) : 0.f };
+
+			color += (light.intensity * attenuation) * light.color * (observedArea * lambert + specularColor * phong);
 		}
-		else
+
+		return color;
+	}
+
+	void dae::Renderer::PixelShadingDepth(const PixelQuad& quad) const
+	{
+		ColorRGB finalColors[PixelQuad::LaneCount]{};
+		for (int i{}; i < PixelQuad::LaneCount; ++i)
 		{
-			const float depthCol{ Utils::Remap(v.position.w,0.985f,1.f) };
-			finalColor = { depthCol,depthCol,depthCol };
+			const float depthCol{ Utils::Remap(quad.fragments[i].position.z,0.985f,1.f) };
+			finalColors[i] = { depthCol,depthCol,depthCol };
 		}
 
-		//Update Color in Buffer
-		finalColor.MaxToOne();
+		WritePixels(quad, finalColors);
+	}
 
-		const int px{ static_cast<int>(v.position.x) };
-		const int py{ static_cast<int>(v.position.y) };
+	void dae::Renderer::ResolveOutputFormat() const
+	{
+		const SDL_PixelFormat* pFormat{ m_pBackBuffer->format };
+		m_OutputFormat.redShift = pFormat->Rshift;
+		m_OutputFormat.greenShift = pFormat->Gshift;
+		m_OutputFormat.blueShift = pFormat->Bshift;
+		m_OutputFormat.alphaMask = pFormat->Amask;
+	}
+
+	ColorRGB dae::Renderer::UnpackColor(uint32_t pixel) const
+	{
+		const constexpr float invClampVal{ 1 / 255.f };
+
+		return { ((pixel >> m_OutputFormat.redShift) & 0xFF) * invClampVal,
+			((pixel >> m_OutputFormat.greenShift) & 0xFF) * invClampVal,
+			((pixel >> m_OutputFormat.blueShift) & 0xFF) * invClampVal };
+	}
+
+	uint32_t dae::Renderer::PackColor(ColorRGB color) const
+	{
+		color.MaxToOne();
+
+		return (static_cast<uint32_t>(Saturate(color.r) * 255) << m_OutputFormat.redShift)
+			| (static_cast<uint32_t>(Saturate(color.g) * 255) << m_OutputFormat.greenShift)
+			| (static_cast<uint32_t>(Saturate(color.b) * 255) << m_OutputFormat.blueShift)
+			| m_OutputFormat.alphaMask;
+	}
+
+	void dae::Renderer::WritePixels(const PixelQuad& quad, const ColorRGB* pColors) const
+	{
+		// Top left pixel of each quad row
+		const int rowIndices[2]
+		{
+			static_cast<int>(quad.fragments[0].position.x) + static_cast<int>(quad.fragments[0].position.y) * m_RenderWidth,
+			static_cast<int>(quad.fragments[2].position.x) + static_cast<int>(quad.fragments[2].position.y) * m_RenderWidth
+		};
+
+#if defined(DAE_SIMD_SSE)
+		__m128 r{ _mm_setr_ps(pColors[0].r, pColors[1].r, pColors[2].r, pColors[3].r) };
+		__m128 g{ _mm_setr_ps(pColors[0].g, pColors[1].g, pColors[2].g, pColors[3].g) };
+		__m128 b{ _mm_setr_ps(pColors[0].b, pColors[1].b, pColors[2].b, pColors[3].b) };
+
+		// MaxToOne
+		const __m128 invMax{ _mm_div_ps(_mm_set1_ps(1.f), _mm_max_ps(_mm_max_ps(r, g), _mm_max_ps(b, _mm_set1_ps(1.f)))) };
+		r = _mm_mul_ps(r, invMax);
+		g = _mm_mul_ps(g, invMax);
+		b = _mm_mul_ps(b, invMax);
+
+		const __m128i packed{ SIMD::PackColors(r, g, b,
+			_mm_cvtsi32_si128(m_OutputFormat.redShift), _mm_cvtsi32_si128(m_OutputFormat.greenShift), _mm_cvtsi32_si128(m_OutputFormat.blueShift),
+			_mm_set1_epi32(static_cast<int>(m_OutputFormat.alphaMask))) };
+
+		alignas(16) uint32_t pixels[PixelQuad::LaneCount];
+		_mm_store_si128(reinterpret_cast<__m128i*>(pixels), packed);
+
+		for (int row{}; row < 2; ++row)
+		{
+			const uint32_t rowMask{ (quad.coverageMask >> (row * 2)) & 0b11 };
+			if (rowMask == 0b11)
+			{
+				// Both pixels of the row, single 64 bit store
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(m_pBackBufferPixels + rowIndices[row]), row == 0 ? packed : _mm_srli_si128(packed, 8));
+			}
+			else if (rowMask != 0)
+			{
+				const int column{ rowMask == 0b01 ? 0 : 1 };
+				m_pBackBufferPixels[rowIndices[row] + column] = pixels[row * 2 + column];
+			}
+		}
+#else
+		for (int lane{}; lane < PixelQuad::LaneCount; ++lane)
+		{
+			if (!quad.IsCovered(lane)) continue;
+			m_pBackBufferPixels[rowIndices[lane >> 1] + (lane & 1)] = PackColor(pColors[lane]);
+		}
+#endif
+	}
+
+	void dae::Renderer::BlendPixels(const PixelQuad& quad, const ColorRGB* pColors, const float* pAlphas) const
+	{
+		if (quad.coverageMask == 0) return;
+
+		// Top left pixel of each quad row
+		const int rowIndices[2]
+		{
+			static_cast<int>(quad.fragments[0].position.x) + static_cast<int>(quad.fragments[0].position.y) * m_RenderWidth,
+			static_cast<int>(quad.fragments[2].position.x) + static_cast<int>(quad.fragments[2].position.y) * m_RenderWidth
+		};
+
+#if defined(DAE_SIMD_SSE)
+		// Only the covered lanes are read, the helpers may lie outside of the render target
+		alignas(16) uint32_t pixels[PixelQuad::LaneCount]{};
+		for (int lane{}; lane < PixelQuad::LaneCount; ++lane)
+		{
+			if (quad.IsCovered(lane)) pixels[lane] = m_pBackBufferPixels[rowIndices[lane >> 1] + (lane & 1)];
+		}
+
+		const __m128i rShift{ _mm_cvtsi32_si128(m_OutputFormat.redShift) };
+		const __m128i gShift{ _mm_cvtsi32_si128(m_OutputFormat.greenShift) };
+		const __m128i bShift{ _mm_cvtsi32_si128(m_OutputFormat.blueShift) };
+		__m128 destinationR{}, destinationG{}, destinationB{};
+		SIMD::UnpackColors(_mm_load_si128(reinterpret_cast<const __m128i*>(pixels)), rShift, gShift, bShift, destinationR, destinationG, destinationB);
+
+		// source * alpha + destination * (1 - alpha) = destination + (source - destination) * alpha
+		const __m128 alpha{ _mm_loadu_ps(pAlphas) };
+		const __m128 r{ _mm_add_ps(destinationR, _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(pColors[0].r, pColors[1].r, pColors[2].r, pColors[3].r), destinationR), alpha)) };
+		const __m128 g{ _mm_add_ps(destinationG, _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(pColors[0].g, pColors[1].g, pColors[2].g, pColors[3].g), destinationG), alpha)) };
+		const __m128 b{ _mm_add_ps(destinationB, _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(pColors[0].b, pColors[1].b, pColors[2].b, pColors[3].b), destinationB), alpha)) };
+
+		const __m128i packed{ SIMD::PackColors(r, g, b, rShift, gShift, bShift, _mm_set1_epi32(static_cast<int>(m_OutputFormat.alphaMask))) };
+		_mm_store_si128(reinterpret_cast<__m128i*>(pixels), packed);
+
+		for (int row{}; row < 2; ++row)
+		{
+			const uint32_t rowMask{ (quad.coverageMask >> (row * 2)) & 0b11 };
+			if (rowMask == 0b11)
+			{
+				// Both pixels of the row, single 64 bit store
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(m_pBackBufferPixels + rowIndices[row]), row == 0 ? packed : _mm_srli_si128(packed, 8));
+			}
+			else if (rowMask != 0)
+			{
+				const int column{ rowMask == 0b01 ? 0 : 1 };
+				m_pBackBufferPixels[rowIndices[row] + column] = pixels[row * 2 + column];
+			}
+		}
+#else
+		for (int lane{}; lane < PixelQuad::LaneCount; ++lane)
+		{
+			if (!quad.IsCovered(lane)) continue;
+
+			uint32_t& pixel{ m_pBackBufferPixels[rowIndices[lane >> 1] + (lane & 1)] };
+			pixel = PackColor(pColors[lane] * pAlphas[lane] + UnpackColor(pixel) * (1.f - pAlphas[lane]));
+		}
+#endif
+	}
+
+	void dae::Renderer::RenderTransparentMesh(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster) const
+	{
+		DAE_PROFILE_ZONE("Transparent");
+		const FrameSnapshot& frame{ GetRenderFrame() };
+
+		// Gather the visible triangles, keyed on their view space depth
+		std::vector<TransparentTriangle> visibleTriangles;
+		std::vector<Utils::SortItem> sortItems;
+
+		const int nrTriangles{ static_cast<int>(mesh.primitiveTopology == PrimitiveTopology::TriangleList ? mesh.indices.size() / 3 : mesh.indices.size() - 2) };
+		visibleTriangles.reserve(nrTriangles);
+		sortItems.reserve(nrTriangles);
+
+		for (int triangleIdx{}; triangleIdx < nrTriangles; ++triangleIdx)
+		{
+			TransparentTriangle triangle{};
+			if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
+			{
+				triangle.vertIdx0 = mesh.indices[triangleIdx * 3];
+				triangle.vertIdx1 = mesh.indices[triangleIdx * 3 + 1];
+				triangle.vertIdx2 = mesh.indices[triangleIdx * 3 + 2];
+			}
+			else
+			{
+				// Winding doesn't matter, transparency isn't culled
+				triangle.vertIdx0 = mesh.indices[triangleIdx];
+				triangle.vertIdx1 = mesh.indices[triangleIdx + 1];
+				triangle.vertIdx2 = mesh.indices[triangleIdx + 2];
+			}
+
+			if (triangle.vertIdx0 == triangle.vertIdx1 || triangle.vertIdx1 == triangle.vertIdx2 || triangle.vertIdx2 == triangle.vertIdx0)
+			{
+				continue;
+			}
+
+			const Vertex_Out& v0{ mesh.vertices_out[triangle.vertIdx0] };
+			const Vertex_Out& v1{ mesh.vertices_out[triangle.vertIdx1] };
+			const Vertex_Out& v2{ mesh.vertices_out[triangle.vertIdx2] };
+			if (frame.camera.ShouldVertexBeClipped(v0.position) || frame.camera.ShouldVertexBeClipped(v1.position) || frame.camera.ShouldVertexBeClipped(v2.position))
+			{
+				continue;
+			}
+
+			const Vector2& vert0{ vertices_raster[triangle.vertIdx0] };
+			const Vector2& vert1{ vertices_raster[triangle.vertIdx1] };
+			const Vector2& vert2{ vertices_raster[triangle.vertIdx2] };
+			triangle.bbTopLeft = Vector2::Min(vert0, Vector2::Min(vert1, vert2));
+			triangle.bbBotRight = Vector2::Max(vert0, Vector2::Max(vert1, vert2));
+
+			// Inverted key, the farthest triangle sorts first
+			const float viewDepth{ (v0.position.w + v1.position.w + v2.position.w) / 3.f };
+			sortItems.push_back({ ~Utils::FloatToSortKey(viewDepth), static_cast<uint32_t>(visibleTriangles.size()) });
+			visibleTriangles.push_back(triangle);
+		}
+
+		// Back to front
+		Utils::RadixSort(sortItems, *m_pJobSystem);
+
+		std::vector<TransparentTriangle> sortedTriangles;
+		sortedTriangles.reserve(sortItems.size());
+		for (const Utils::SortItem& item : sortItems)
+		{
+			sortedTriangles.push_back(visibleTriangles[item.value]);
+		}
+
+		// Into the tiles their bounds touch, in sorted order, so every tile still blends back to front
+		m_TransparentTileBins.resize(m_IsTileDirty.size());
+		for (std::vector<uint32_t>& bin : m_TransparentTileBins)
+		{
+			bin.clear();
+		}
+		for (uint32_t triangleIdx{}; triangleIdx < sortedTriangles.size(); ++triangleIdx)
+		{
+			const TransparentTriangle& triangle{ sortedTriangles[triangleIdx] };
+			// Same bounds as RenderTransparentTriangle
+			const int startX{ static_cast<int>(Clamp(triangle.bbTopLeft.x - 1.f, 0.f, static_cast<float>(m_RenderWidth))) };
+			const int startY{ static_cast<int>(Clamp(triangle.bbTopLeft.y - 1.f, 0.f, static_cast<float>(m_RenderHeight))) };
+			const int endX{ static_cast<int>(Clamp(triangle.bbBotRight.x + 1.f, 0.f, static_cast<float>(m_RenderWidth))) };
+			const int endY{ static_cast<int>(Clamp(triangle.bbBotRight.y + 1.f, 0.f, static_cast<float>(m_RenderHeight))) };
+			if (startX >= endX || startY >= endY) continue;
+
+			for (int tileY{ startY / m_TileSize }; tileY <= (endY - 1) / m_TileSize; ++tileY)
+			{
+				for (int tileX{ startX / m_TileSize }; tileX <= (endX - 1) / m_TileSize; ++tileX)
+				{
+					const int tileIdx{ tileX + tileY * m_NrTilesX };
+					if (m_IsTileDirty[tileIdx]) m_TransparentTileBins[tileIdx].push_back(triangleIdx);
+				}
+			}
+		}
+
+		m_pJobSystem->ParallelFor(m_TransparentTileBins.size(), 1, [&](size_t begin, size_t end)
+			{
+				for (size_t tileIdx{ begin }; tileIdx < end; ++tileIdx)
+				{
+					if (m_TransparentTileBins[tileIdx].empty()) continue;
+					// The tile may not have been touched by the opaque pass
+					MaterializeTileClear(tileIdx);
+
+					const int tileX{ static_cast<int>(tileIdx) % m_NrTilesX * m_TileSize };
+					const int tileY{ static_cast<int>(tileIdx) / m_NrTilesX * m_TileSize };
+					for (const uint32_t triangleIdx : m_TransparentTileBins[tileIdx])
+					{
+						RenderTransparentTriangle(mesh, vertices_raster, sortedTriangles[triangleIdx], tileX, tileY);
+					}
+				}
+			});
+	}
+
+	void dae::Renderer::RenderTransparentTriangle(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, const TransparentTriangle& triangle, int tileX, int tileY) const
+	{
+		// Same margin as the opaque triangles, clamped to the screen and the tile
+		const int startX{ std::max(static_cast<int>(Clamp(triangle.bbTopLeft.x - 1.f, 0.f, static_cast<float>(m_RenderWidth))), tileX) };
+		const int startY{ std::max(static_cast<int>(Clamp(triangle.bbTopLeft.y - 1.f, 0.f, static_cast<float>(m_RenderHeight))), tileY) };
+		const int endX{ std::min(static_cast<int>(Clamp(triangle.bbBotRight.x + 1.f, 0.f, static_cast<float>(m_RenderWidth))), tileX + m_TileSize) };
+		const int endY{ std::min(static_cast<int>(Clamp(triangle.bbBotRight.y + 1.f, 0.f, static_cast<float>(m_RenderHeight))), tileY + m_TileSize) };
+		if (startX >= endX || startY >= endY) return;
+
+		const Vector2& vert0{ vertices_raster[triangle.vertIdx0] };
+		const Vector2& vert1{ vertices_raster[triangle.vertIdx1] };
+		const Vector2& vert2{ vertices_raster[triangle.vertIdx2] };
+
+		const float totalTriangleArea{ Vector2::Cross(vert1 - vert0,vert2 - vert0) };
+		if (totalTriangleArea == 0.f) return;
+		const float invTotalTriangleArea{ 1 / totalTriangleArea };
+
+		const Vertex_Out& v0{ mesh.vertices_out[triangle.vertIdx0] };
+		const Vertex_Out& v1{ mesh.vertices_out[triangle.vertIdx1] };
+		const Vertex_Out& v2{ mesh.vertices_out[triangle.vertIdx2] };
+
+		const Texture* pDiffuseTexture{ m_pFireDiffuseTexture->Get() };
+
+		// Aligned to even pixels like the opaque pass, lanes that aren't covered are still interpolated for the uv derivatives
+		for (int qy{ startY & ~1 }; qy < endY; qy += 2)
+		{
+			for (int qx{ startX & ~1 }; qx < endX; qx += 2)
+			{
+				PixelQuad quad{};
+				for (int lane{}; lane < PixelQuad::LaneCount; ++lane)
+				{
+					const int px{ qx + (lane & 1) };
+					const int py{ qy + (lane >> 1) };
+					const Vector2 currentPixel{ static_cast<float>(px),static_cast<float>(py) };
 
-		m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-			static_cast<uint8_t>(finalColor.r * 255),
-			static_cast<uint8_t>(finalColor.g * 255),
-			static_cast<uint8_t>(finalColor.b * 255));
+					const float weight0{ Vector2::Cross((currentPixel - vert1), (vert1 - vert2)) * invTotalTriangleArea };
+					const float weight1{ Vector2::Cross((currentPixel - vert2), (vert2 - vert0)) * invTotalTriangleArea };
+					const float weight2{ Vector2::Cross((currentPixel - vert0), (vert0 - vert1)) * invTotalTriangleArea };
+
+					Vertex_Out& fragment{ quad.fragments[lane] };
+					const float interpolatedW{ 1.f / (weight0 / v0.position.w + weight1 / v1.position.w + weight2 / v2.position.w) };
+					fragment.position = { currentPixel.x, currentPixel.y, 0.f, interpolatedW };
+					fragment.uv = interpolatedW * (weight0 * v0.uv / v0.position.w + weight1 * v1.uv / v1.position.w + weight2 * v2.uv / v2.position.w);
+
+					if (px < startX || px >= endX || py < startY || py >= endY) continue;
+					if (!Utils::IsFrontFaceHit(currentPixel, vert0, vert1, vert2) && !Utils::IsBackFaceHit(currentPixel, vert0, vert1, vert2)) continue;
+
+					// Depth test only, transparent surfaces don't occlude each other
+					const float interpolatedDepth{ 1.f / (weight0 / v0.position.z + weight1 / v1.position.z + weight2 / v2.position.z) };
+					if (m_pDepthBufferPixels[px + py * m_RenderWidth] < interpolatedDepth || interpolatedDepth < 0.f || interpolatedDepth > 1.f) continue;
+					fragment.position.z = interpolatedDepth;
+
+					quad.coverageMask |= 1u << lane;
+				}
+				if (quad.coverageMask == 0) continue;
+
+				quad.uvDdx = quad.fragments[1].uv - quad.fragments[0].uv;
+				quad.uvDdy = quad.fragments[2].uv - quad.fragments[0].uv;
+				const int diffuseMip{ pDiffuseTexture->CalculateMip(quad.uvDdx, quad.uvDdy) };
+
+				ColorRGB colors[PixelQuad::LaneCount]{};
+				float alphas[PixelQuad::LaneCount]{};
+				for (int lane{}; lane < PixelQuad::LaneCount; ++lane)
+				{
+					if (!quad.IsCovered(lane)) continue;
+
+					colors[lane] = pDiffuseTexture->SampleLevel(quad.fragments[lane].uv, diffuseMip, alphas[lane]);
+					// Fully transparent texels leave the pixel as it is
+					if (alphas[lane] <= 0.f) quad.coverageMask &= ~(1u << lane);
+				}
+
+				BlendPixels(quad, colors, alphas);
+			}
+		}
 	}
 
 	void Renderer::Render_hardware() const
 	{
+		DAE_PROFILE_ZONE("Render hardware");
+
 		// 1. Clear RTV and DSV
-		ColorRGB clearColor{ (m_EnableUniformClearColor ? m_UniformClearColor : m_HardwareClearColor) };
+		ColorRGB clearColor{ (m_Settings.enableUniformClearColor ? m_UniformClearColor : m_HardwareClearColor) };
 
 		m_pDeviceContext->ClearRenderTargetView(m_pRenderTargetView, &clearColor.r);
 		m_pDeviceContext->ClearDepthStencilView(m_pDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
@@ -590,7 +2324,7 @@ namespace dae {
 		// 2. Set pipeline + Invoke drawcalls (= render)
 		for (const auto& pMesh : m_pMeshes)
 		{
-			if (m_EnableFireFX && pMesh == m_pFireFX) continue;
+			if (!m_Settings.enableFireFX && pMesh == m_pFireFX) continue;
 			pMesh->Render(m_pDeviceContext);
 		}
 
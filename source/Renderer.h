@@ -1,5 +1,7 @@
 #pragma once
 #include <functional>
+#include <chrono>
+#include "JobSystem.h"
 #include "Camera.h"
 #include "Effect.h"
 #include "DataTypes.h"
@@ -11,11 +13,17 @@ namespace dae
 {
 	class UntexturedMesh;
 	class Mesh;
+	class TextureHandle;
+	class TextureManager;
+	class LightClusters;
+	class ShadowMap;
+	class Presenter;
 
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
+		// nrWorkers is the worker thread count of the job system, -1 picks one per hardware thread
+		Renderer(SDL_Window* pWindow, int nrWorkers = -1);
 		~Renderer();
 
 		Renderer(const Renderer&) = delete;
@@ -23,8 +31,19 @@ namespace dae
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
+		// Input that arrived since the last frame, in the order it was received
+		void HandleInput(const InputEvent& input);
+		// Updates frame N + 1 into a snapshot while frame N is still rendering from the other one
 		void Update(const Timer* pTimer);
-		void Render() const;
+		// Finishes and presents frame N, then starts rendering the snapshot Update just wrote
+		void Render();
+
+		// Printed together with the FPS (F11), waits for the frame in flight
+		void PrintStats() const;
+
+		// The last Render call had nothing new to show, the main loop can wait for input instead of spinning
+		bool IsIdle() const { return m_IsIdle; }
+
 
 		// ------ SHARED ------
 		//
@@ -32,6 +51,8 @@ namespace dae
 		void ToggleBetweenHardwareSoftware();
 		// F2
 		void ToggleRotation();
+		// F3
+		void ToggleFireFXMesh();
 		// F9 
 		void CycleCullModes();
 		// F10
@@ -41,8 +62,6 @@ namespace dae
 
 		// ------ HARDWARE ONLY ------
 		//
-		// F3
-		void ToggleFireFXMesh();
 		// F4
 		void ToggleTextureSamplingStates();
 
@@ -56,8 +75,31 @@ namespace dae
 		void ToggleDepthBufferVisualisation();
 		// F8
 		void ToggleBoundingBoxVisualisation();
+		// 1
+		void ToggleLocalLights();
+		// 2
+		void ToggleShadows();
+		// 3
+		void ToggleZPrepass();
+		// 4
+		void ToggleFramePipelining();
+		// 5
+		void CycleLatencyMode();
+		// 6
+		void ToggleDynamicResolution();
+		// 7
+		void ToggleCheckerboard();
+		// 8
+		void ToggleVariableRateShading();
+		// 9
+		void ToggleShadingRateVisualisation();
+		// 0
+		void ToggleIncrementalRendering();
 
 	private:
+		// Runs the parallel passes and the asset loading, declared first so it outlives everything that schedules jobs
+		std::unique_ptr<JobSystem> m_pJobSystem;
+
 		// Base
 		SDL_Window* m_pWindow{};
 
@@ -75,15 +117,9 @@ namespace dae
 		std::function<void()> m_pCurrentRendererfunction;
 
 		bool m_EnableRotation{ true };
-		bool m_EnableUniformClearColor{ false };
-		bool m_EnableFireFX{ true };
 		const Mesh* m_pFireFX{ nullptr };
-		bool m_EnableNormalMap{ true };
-		bool m_EnableDepthBufferVisualisation{ false };
-		bool m_EnableBoundingBoxVisualisation{ false };
 		Effect::FilteringMethod m_FilteringMethod{ Effect::FilteringMethod::Point };
-		CullingMode m_CullingMode{ CullingMode::Back };
-		// Shading method is under software
+		// The other render toggles are under software
 
 		// ...
 		Camera m_Camera;
@@ -104,42 +140,346 @@ namespace dae
 			Combined,
 			END
 		};
-		SDL_Surface* m_pFrontBuffer{ nullptr };
-		SDL_Surface* m_pBackBuffer{ nullptr };
-		uint32_t* m_pBackBufferPixels{};
+
+		// Render toggles, the key bindings change m_Settings and every frame renders with the copy in its snapshot
+		struct RenderSettings
+		{
+			ShadingMode shadingMode{ ShadingMode::Combined };
+			CullingMode cullingMode{ CullingMode::Back };
+			bool enableUniformClearColor{ false };
+			bool enableFireFX{ true };
+			bool enableNormalMap{ true };
+			bool enableDepthBufferVisualisation{ false };
+			bool enableBoundingBoxVisualisation{ false };
+			bool enableLocalLights{ false };
+			bool enableShadows{ false };
+			bool enableZPrepass{ false };
+			bool enableDynamicResolution{ false };
+			bool enableCheckerboard{ false };
+			bool enableVariableRateShading{ false };
+			bool enableShadingRateVisualisation{ false };
+			// Keeps the previous frame in the internal buffer, which costs the zero copy present
+			bool enableIncrementalRendering{ false };
+
+			bool operator==(const RenderSettings& other) const = default;
+		};
+		RenderSettings m_Settings{};
+
+		// Frame pipelining, the render of frame N runs as a job while the frame thread updates frame N + 1.
+		// Everything the render reads that Update or the key bindings change goes through a snapshot,
+		// so the two never touch the same state. Costs at most one frame of latency, which is measured.
+		using Clock = std::chrono::steady_clock;
+		struct MeshTransform
+		{
+			Vector3 position{};
+			Quaternion rotation{};
+			Vector3 scale{};
+		};
+		// Incremental rendering, a frame is only rendered when something that reaches the screen changed since the last rendered one.
+		// When only meshes moved, just the tiles under their old and new screen bounds are rendered again,
+		// on top of the previous frame, which stays in the internal buffer.
+		enum class FrameChange
+		{
+			None,
+			Meshes,	// only the transforms of the meshes flagged in changedMeshes
+			Full
+		};
+		struct FrameSnapshot
+		{
+			Camera camera{};
+			std::vector<MeshTransform> meshTransforms{};	// same order as m_pMeshes
+			RenderSettings settings{};
+			Clock::time_point updateTime{};
+			// Filled in by Render, against the last rendered snapshot
+			FrameChange change{ FrameChange::Full };
+			std::vector<uint8_t> changedMeshes{};		// same order as m_pMeshes
+		};
+		bool m_EnableFramePipelining{ true };
+		FrameSnapshot m_Frames[2]{};
+		int m_RenderFrameIdx{};
+		JobHandle m_RenderJob{};
+		// Update -> present of the hardware path, smoothed. The software path is measured by the present thread.
+		float m_FrameLatencyMs{};
+
+		void CaptureFrame(const Camera& camera, const std::vector<MeshTransform>& meshTransforms);
+		// Waits for the frame in flight and presents it
+		void FinishFrame();
+
+		// Fixed timestep simulation, Update runs as many steps as the elapsed time holds and the frame shows
+		// the state interpolated between the last two steps. So the simulation doesn't depend on the render rate.
+		// 120 Hz, input waits at most one step for the step it arrived in
+		static constexpr float m_FixedTimeStep{ 1.f / 120.f };
+		// A longer hitch is dropped instead of caught up on, a slow frame can't snowball into ever more steps
+		static constexpr int m_MaxStepsPerUpdate{ 16 };
+		float m_SimulationAccumulator{};
+		Camera m_PreviousCamera{};
+		std::vector<MeshTransform> m_PreviousMeshTransforms{};		// same order as m_pMeshes
+		// Input is handed to the step it arrived in, what arrived after the last step waits for the next Update
+		std::vector<InputEvent> m_PendingInput{};
+		struct SimulationStats
+		{
+			uint64_t steps{};
+			float droppedMs{};
+		};
+		SimulationStats m_SimulationStats{};
+
+		void Simulate(Clock::time_point stepEndTime);
+		static MeshTransform InterpolateTransform(const MeshTransform& previous, const MeshTransform& current, float alpha);
+
+		// Frame thread side of the incremental rendering
+		FrameSnapshot m_LastRenderedFrame{};
+		bool m_IsIdle{ false };
+		bool m_ForceFullFrame{ true };
+		// Checkerboard and variable rate shading converge over a few frames, the frames after the last change are still rendered in full
+		static constexpr int m_SettleFrameCount{ 2 };
+		int m_NrSettleFrames{};
+		struct IncrementalStats
+		{
+			uint64_t fullFrames{};
+			uint64_t partialFrames{};
+			uint64_t skippedFrames{};
+		};
+		IncrementalStats m_IncrementalStats{};
+		// Compares the snapshot about to be rendered with the last rendered one and stores the result in it
+		FrameChange DetectFrameChange(bool haveTexturesChanged);
+
+		// Render side, screen bounds of every mesh when it was last rendered (same order as m_pMeshes) and the tiles to render this frame
+		struct ScreenRect
+		{
+			int minX{ 1 };
+			int minY{ 1 };
+			int maxX{};	// exclusive
+			int maxY{};
+			bool IsEmpty() const { return minX >= maxX || minY >= maxY; }
+		};
+		mutable std::vector<ScreenRect> m_MeshScreenRects;
+		mutable std::vector<uint8_t> m_IsTileDirty;
+		// Share of the tiles the last frame rendered
+		mutable float m_DirtyTileRatio{};
+		// Renders into m_ScaledBackBuffer, which keeps the previous frame for a partial one
+		mutable bool m_IsUsingInternalBuffer{ false };
+		ScreenRect CalculateScreenRect(const std::vector<Vector2>& vertices_raster) const;
+		void MarkDirtyTiles(const ScreenRect& rect) const;
+		void RecordFrameLatency();
+		const FrameSnapshot& GetRenderFrame() const { return m_Frames[m_RenderFrameIdx]; }
+		// Present thread with a ring of back buffers, every frame renders into the buffer it acquired
+		std::unique_ptr<Presenter> m_pPresenter;
+		mutable SDL_Surface* m_pBackBuffer{ nullptr };
+		mutable uint32_t* m_pBackBufferPixels{};
 
 		float* m_pDepthBufferPixels{};
 
-		std::unique_ptr<Texture> m_pVehicleDiffuseTexture;
-		std::unique_ptr<Texture> m_pVehicleNormalTexture;
-		std::unique_ptr<Texture> m_pVehicleSpecularTexture;
-		std::unique_ptr<Texture> m_pVehicleGlossinessTexture;
+		// Dynamic resolution, the software path renders at a fraction of the window size and is upscaled into the acquired buffer.
+		// The depth buffer, tiles and light clusters all follow the internal resolution, the window and the presenter don't know about it.
+		// At full scale the frame renders straight into the acquired buffer, so zero copy still skips every copy, unless incremental rendering needs the previous frame kept around.
+		const float m_TargetFrameMs{ 1000.f / 60.f };
+		static constexpr float m_MinRenderScale{ 0.5f };
+		mutable int m_RenderWidth{};
+		mutable int m_RenderHeight{};
+		mutable float m_RenderScale{ 1.f };
+		// Frame time controller state, smoothed. The raster cost is tracked per pixel since the frame time lags behind a resolution change.
+		struct ResolutionStats
+		{
+			float renderMs{};
+			float upscaleMs{};
+			float msPerMegapixel{};
+			uint64_t resolutionChanges{};
+		};
+		mutable ResolutionStats m_ResolutionStats{};
+		// Internal color buffer, rendered into below full scale and by incremental rendering
+		mutable std::vector<uint32_t> m_ScaledBackBuffer;
+		// Per output column, the two source columns and the weight between them
+		mutable std::vector<uint32_t> m_UpscaleX0;
+		mutable std::vector<uint32_t> m_UpscaleX1;
+		mutable std::vector<uint16_t> m_UpscaleFx;
+
+		// Applies m_RenderScale to the internal resolution and everything sized after it, returns true when it changed
+		bool ResizeRenderTarget() const;
+		// Steers m_RenderScale towards the frame time target for the next frame
+		void UpdateRenderScale(float renderMs) const;
+		bool IsRenderingAtFullScale() const { return m_RenderWidth == m_Width && m_RenderHeight == m_Height; }
+		// Bilinear, from the internal buffer into the acquired one. A plain copy at full scale.
+		void UpscaleBackBuffer() const;
+
+		std::unique_ptr<TextureHandle> m_pVehicleDiffuseTexture;
+		std::unique_ptr<TextureHandle> m_pVehicleNormalTexture;
+		std::unique_ptr<TextureHandle> m_pVehicleSpecularTexture;
+		std::unique_ptr<TextureHandle> m_pVehicleGlossinessTexture;
+		std::unique_ptr<TextureHandle> m_pFireDiffuseTexture;
 
-		ShadingMode m_ShadingMode{ ShadingMode::Combined };
+		// Binds the textures that finished loading since the last frame and syncs texture streaming.
+		// Returns true when a texture or a streamed mip changed.
+		bool ResolveTextures();
+
+		// Software mips are streamed in under this budget
+		const size_t m_TextureBudgetBytes{ 16 * 1024 * 1024 };
+		std::unique_ptr<TextureManager> m_pTextureManager;
 
 		const DirectionalLight m_GlobalLight{ Vector3{ .577f,-.557f,.577f }.Normalized() , 7.f };
 		const float m_SpecularShininess{ 25.0f };
 		const ColorRGB m_AmbientColor{ 0.025f, 0.025f, 0.025f };
 
+		// Point and spot lights, assigned to screen tile x depth slice clusters every frame
+		std::vector<LocalLight> m_Lights;
+		std::unique_ptr<LightClusters> m_pLightClusters;
+		void CreateLocalLights();
+		ColorRGB ShadeLocalLights(const Vertex_Out& v, const Vector3& normal, const ColorRGB& lambert, const ColorRGB& specularColor, float exponent) const;
+
+		// Shadows of the global light, the map is only rebuilt when the light or a caster moved
+		const int m_ShadowMapSize{ 1024 };
+		std::unique_ptr<ShadowMap> m_pShadowMap;
+
 		//Function that transforms the vertices from the mesh from World space to Screen space
 		void VertexTransformationFunction(UntexturedMesh& mesh) const;
+		// Vertices per transform job
+		static constexpr size_t m_VertexBatchSize{ 1024 };
 		// std::fill_n(m_pDepthBufferPixels, (m_Width * m_Height), FLT_MAX);
 		inline void ResetDepthBuffer() const { std::fill_n(m_pDepthBufferPixels, (m_Width * m_Height), FLT_MAX); }
-		// SDL_FillRect(m_pBackBuffer, NULL, SDL_MapRGB(m_pBackBuffer->format, r, g, b ));
-		inline void ClearBackground() const 
-		{ 
-			Uint8 r, g, b;
-			ColorRGB clearColor{ (m_EnableUniformClearColor ? m_UniformClearColor : m_SoftwareClearColor) };
-			clearColor *= 255;
-			r = static_cast<Uint8>(clearColor.r);
-			g = static_cast<Uint8>(clearColor.g);
-			b = static_cast<Uint8>(clearColor.b);
-			SDL_FillRect(m_pBackBuffer, NULL, SDL_MapRGB(m_pBackBuffer->format, r, g, b)); 
-		}
-
-		void RenderMeshTriangle(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, int currentVertexIdx, bool swapVertices) const;
-
-		void PixelShading(const Vertex_Out& v) const;
+
+		// Color writes depth and shades every fragment that passes, DepthOnly only writes depth,
+		// ColorEqualDepth shades the fragments that match the depth laid down by a DepthOnly pass
+		enum class RasterPass
+		{
+			Color,
+			DepthOnly,
+			ColorEqualDepth
+		};
+		// Per tile, the first index (in mesh.indices) of every triangle whose bounding box touches it
+		using TileBins = std::vector<std::vector<uint32_t>>;
+		template<RasterPass rasterPass>
+		void RenderMesh(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, const TileBins& tileBins) const;
+		template<RasterPass rasterPass>
+		void RenderMeshTriangle(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, int currentVertexIdx, int tileX, int tileY) const;
+
+		// The screen is split in tiles that are rasterized in parallel, every tile only touches its own pixels.
+		// Tiles are a multiple of 2, so the pixel quads never straddle two tiles.
+		static constexpr int m_TileSize{ 64 };
+		mutable int m_NrTilesX{};
+		mutable int m_NrTilesY{};
+		// One set per opaque mesh, a z-prepass runs the depth of every mesh before the color of any, both from the same bins
+		mutable std::vector<TileBins> m_MeshTileBins;
+		void BinTriangles(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, TileBins& tileBins) const;
+
+		// Fast clear, once per frame. Every tile starts the frame flagged as cleared without any memory being touched,
+		// the first pass that renders into a tile fills in its clear depth and color while the tile is about to be in cache anyway.
+		// Tiles nothing rendered into only get the clear color at the end of the frame, with streaming stores.
+		// A tile is only ever handled by one job per pass, so the flags need no synchronisation.
+		mutable std::vector<uint8_t> m_IsTileCleared;
+		mutable uint32_t m_ClearColorPixel{};
+		void BeginFrameClear() const;
+		void MaterializeTileClear(size_t tileIdx) const;
+		void ResolveTileClears() const;
+
+		// Z-prepass, so every pixel is shaded once: depth for all opaque meshes first, then color where the depth matches.
+		// The whole opaque pass is timed once per frame. Only the strategy in use is measured, toggle to compare.
+		struct OpaquePassTimings
+		{
+			bool isPrepass{ false };	// strategy of the last frame, the other one isn't measured
+			float directMs{};
+			float prepassDepthMs{};
+			float prepassColorMs{};
+		};
+		mutable OpaquePassTimings m_OpaquePassTimings{};
+
+		// Checkerboard rendering, a frame only shades the 2x2 quads of one color of a checkerboard, the colors alternate every frame.
+		// The other quads are reprojected from the opaque result of the previous frame: the interpolated world position goes
+		// back through this frame's world matrix and forward through last frame's world and camera matrices, so the rotating vehicle
+		// lands on the right pixels. The history is then clamped to the shaded neighbours of this frame, which bounds the ghosting.
+		mutable uint32_t m_CheckerboardParity{};
+		mutable bool m_IsHistoryValid{ false };
+		// Internal resolution, sized for full scale
+		mutable std::vector<uint32_t> m_HistoryBuffer;
+		// Per pixel, the reprojection fell outside of the previous frame
+		mutable std::vector<uint8_t> m_IsHistoryMiss;
+		mutable Matrix m_PreviousViewProjection{};
+		// Same order as the opaque meshes
+		mutable std::vector<AffineTransform> m_PreviousWorldMatrices;
+		// World space of the mesh being rendered --> clip space of the previous frame
+		mutable Matrix m_ReprojectionMatrix{};
+		struct CheckerboardStats
+		{
+			uint32_t reconstructedPixels{};
+			uint32_t historyMisses{};
+		};
+		mutable CheckerboardStats m_CheckerboardStats{};
+
+		bool IsQuadShaded(int qx, int qy) const { return (((qx >> 1) + (qy >> 1) + m_CheckerboardParity) & 1) == 0; }
+		// Writes the history color under the previous position of the pixel, or flags it as a miss
+		void ReprojectPixel(int px, int py, const Vector3& worldPosition) const;
+		// Clamps the reprojected pixels of the opaque pass to their neighbours and keeps the result as the next history
+		void ResolveCheckerboard() const;
+
+		// Variable rate shading, every 16x16 pixel tile shades at 1x1, 2x2 or 4x4 pixels per shaded fragment.
+		// A coarse quad only shades its first covered lane and broadcasts the result to the others, a 4x4 block reuses the color
+		// of the first of its quads the triangle covers. The rates come from the luma range of every tile in the previous frame.
+		enum class ShadingRate : uint8_t
+		{
+			Rate1x1,
+			Rate2x2,
+			Rate4x4,
+			END
+		};
+		static constexpr int m_ShadingRateTileSize{ 16 };
+		mutable int m_NrShadingRateTilesX{};
+		mutable int m_NrShadingRateTilesY{};
+		mutable std::vector<ShadingRate> m_ShadingRates;
+		// Written by this frame for the next one, swapped in at the end of the frame
+		mutable std::vector<ShadingRate> m_NextShadingRates;
+		// Tiles per rate in the last rate map
+		mutable uint32_t m_ShadingRateCounts[static_cast<int>(ShadingRate::END)]{};
+
+		ShadingRate GetShadingRate(int px, int py) const { return m_ShadingRates[px / m_ShadingRateTileSize + py / m_ShadingRateTileSize * m_NrShadingRateTilesX]; }
+		// Rate map of the next frame, from the opaque result of this one
+		void UpdateShadingRates() const;
+		// Tints every tile with the color of its rate
+		void VisualizeShadingRates() const;
+
+		// Pixel shader variants, one per shading mode x normal map, plus the depth buffer visualisation.
+		// Chosen once per frame so the per pixel code doesn't branch on the render toggles.
+		// Fragments are shaded per 2x2 quad, so the lighting runs 4 wide and the quad picks the texture mips.
+		using PixelShaderFunction = void (Renderer::*)(const PixelQuad& quad) const;
+		mutable PixelShaderFunction m_pPixelShader{ nullptr };
+		PixelShaderFunction SelectPixelShader() const;
+
+		template<ShadingMode shadingMode, bool useNormalMap>
+		void PixelShading(const PixelQuad& quad) const;
+		void PixelShadingDepth(const PixelQuad& quad) const;
+
+		// Back buffer pixel layout, resolved once per frame instead of calling SDL_MapRGB per pixel
+		struct OutputFormat
+		{
+			uint32_t redShift{};
+			uint32_t greenShift{};
+			uint32_t blueShift{};
+			uint32_t alphaMask{};
+		};
+		mutable OutputFormat m_OutputFormat{};
+		void ResolveOutputFormat() const;
+		uint32_t PackColor(ColorRGB color) const;
+
+		ColorRGB UnpackColor(uint32_t pixel) const;
+
+		// Scales the colors back to [0, 1] (MaxToOne) and packs the covered lanes of the quad into the back buffer
+		void WritePixels(const PixelQuad& quad, const ColorRGB* pColors) const;
+		// Blends the covered lanes over the back buffer (src_alpha, inv_src_alpha), the colors are already in [0, 1]
+		void BlendPixels(const PixelQuad& quad, const ColorRGB* pColors, const float* pAlphas) const;
+
+		// Transparency (FireFX), rendered after the opaque meshes.
+		// Triangles are sorted back to front and blended over the back buffer, depth tested but without writing depth.
+		// They are binned per tile in that order, every screen tile only touches its own pixels, so the tiles are rendered in parallel.
+		struct TransparentTriangle
+		{
+			uint32_t vertIdx0{};
+			uint32_t vertIdx1{};
+			uint32_t vertIdx2{};
+			Vector2 bbTopLeft{};
+			Vector2 bbBotRight{};
+		};
+		// Per tile, indices into the sorted triangles
+		mutable TileBins m_TransparentTileBins;
+		void RenderTransparentMesh(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster) const;
+		// 2x2 quads like RenderMeshTriangle, so the texture mip comes from the uv derivatives. Both windings, no depth writes.
+		void RenderTransparentTriangle(const UntexturedMesh& mesh, const std::vector<Vector2>& vertices_raster, const TransparentTriangle& triangle, int tileX, int tileY) const;
 
 		//DIRECTX
 		HRESULT InitializeDirectX();
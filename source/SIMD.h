@@ -0,0 +1,230 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include "MathHelpers.h"
+
+// SSE is always available on x64, everything else falls back to the scalar code paths
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define DAE_SIMD_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace dae
+{
+	namespace SIMD
+	{
+#if defined(DAE_SIMD_SSE)
+		// 4 wide versions of FastLog2/FastExp2 from MathHelpers.h, same polynomials and error bounds
+		inline __m128 FastLog2(__m128 x)
+		{
+			const __m128i bits{ _mm_castps_si128(x) };
+			const __m128 exponent{ _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xFF)), _mm_set1_epi32(127))) };
+			const __m128 m{ _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000))) };
+
+			__m128 p{ _mm_set1_ps(-3.4436006e-2f) };
+			p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(3.1821337e-1f));
+			p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.2315303f));
+			p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(2.5988452f));
+			p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-3.3241990f));
+			p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(3.1157899f));
+
+			return _mm_add_ps(_mm_mul_ps(p, _mm_sub_ps(m, _mm_set1_ps(1.f))), exponent);
+		}
+
+		inline __m128 FastExp2(__m128 y)
+		{
+			y = _mm_min_ps(_mm_max_ps(y, _mm_set1_ps(-126.f)), _mm_set1_ps(127.f));
+
+			// floor without SSE4.1: truncate and correct for negative values
+			const __m128i truncated{ _mm_cvttps_epi32(y) };
+			const __m128 truncatedF{ _mm_cvtepi32_ps(truncated) };
+			const __m128i correction{ _mm_castps_si128(_mm_cmpgt_ps(truncatedF, y)) };
+			const __m128i floorI{ _mm_add_epi32(truncated, correction) };
+			const __m128 f{ _mm_sub_ps(y, _mm_cvtepi32_ps(floorI)) };
+
+			__m128 p{ _mm_set1_ps(1.8775767e-3f) };
+			p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(8.9893397e-3f));
+			p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.5826318e-2f));
+			p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.4015361e-1f));
+			p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.9315308e-1f));
+			p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.9999994e-1f));
+
+			const __m128 scale{ _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(floorI, _mm_set1_epi32(127)), 23)) };
+			return _mm_mul_ps(scale, p);
+		}
+
+		inline __m128 FastPow(__m128 base, __m128 exponent)
+		{
+			return FastExp2(_mm_mul_ps(exponent, FastLog2(base)));
+		}
+
+		inline __m128 Dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+		}
+
+		inline __m128 Saturate(__m128 v)
+		{
+			return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.f));
+		}
+
+		// Colors in [0, 1] -> 8 bit channels packed into 4 pixels, shifts are the channel positions in the pixel format
+		inline __m128i PackColors(__m128 r, __m128 g, __m128 b, __m128i rShift, __m128i gShift, __m128i bShift, __m128i alphaMask)
+		{
+			const __m128 scale{ _mm_set1_ps(255.f) };
+			const __m128i ri{ _mm_cvttps_epi32(_mm_mul_ps(Saturate(r), scale)) };
+			const __m128i gi{ _mm_cvttps_epi32(_mm_mul_ps(Saturate(g), scale)) };
+			const __m128i bi{ _mm_cvttps_epi32(_mm_mul_ps(Saturate(b), scale)) };
+
+			return _mm_or_si128(_mm_or_si128(_mm_sll_epi32(ri, rShift), _mm_sll_epi32(gi, gShift)), _mm_or_si128(_mm_sll_epi32(bi, bShift), alphaMask));
+		}
+
+		// Inverse of PackColors, 4 packed pixels -> colors in [0, 1]
+		inline void UnpackColors(__m128i pixels, __m128i rShift, __m128i gShift, __m128i bShift, __m128& r, __m128& g, __m128& b)
+		{
+			const __m128 scale{ _mm_set1_ps(1.f / 255.f) };
+			const __m128i channelMask{ _mm_set1_epi32(0xFF) };
+			r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(pixels, rShift), channelMask)), scale);
+			g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(pixels, gShift), channelMask)), scale);
+			b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(pixels, bShift), channelMask)), scale);
+		}
+#endif
+
+		// Non-temporal fill for memory that isn't read again this frame, it bypasses the cache instead of evicting the working set.
+		// Call StreamFence on the same thread before another thread reads the memory.
+		inline void StreamFill(uint32_t* pDestination, size_t count, uint32_t value)
+		{
+#if defined(DAE_SIMD_SSE)
+			size_t i{};
+			// Scalar up to the first 16 byte boundary
+			for (; i < count && (reinterpret_cast<uintptr_t>(pDestination + i) & 15) != 0; ++i)
+			{
+				pDestination[i] = value;
+			}
+
+			const __m128i values{ _mm_set1_epi32(static_cast<int>(value)) };
+			for (; i + 4 <= count; i += 4)
+			{
+				_mm_stream_si128(reinterpret_cast<__m128i*>(pDestination + i), values);
+			}
+
+			for (; i < count; ++i)
+			{
+				pDestination[i] = value;
+			}
+#else
+			std::fill_n(pDestination, count, value);
+#endif
+		}
+
+		inline void StreamFence()
+		{
+#if defined(DAE_SIMD_SSE)
+			_mm_sfence();
+#endif
+		}
+
+		// Bilinear filter of 4 packed 8 bit pixels, channel order doesn't matter.
+		// Weights are 8 bit fixed point (0 - 256), fx towards p01/p11 and fy towards p10/p11.
+		inline uint32_t BilinearPixel(uint32_t p00, uint32_t p01, uint32_t p10, uint32_t p11, uint32_t fx, uint32_t fy)
+		{
+			uint32_t result{};
+			for (uint32_t shift{}; shift < 32; shift += 8)
+			{
+				const uint32_t top{ (((p00 >> shift) & 0xFF) * (256 - fx) + ((p01 >> shift) & 0xFF) * fx) >> 8 };
+				const uint32_t bottom{ (((p10 >> shift) & 0xFF) * (256 - fx) + ((p11 >> shift) & 0xFF) * fx) >> 8 };
+				result |= ((top * (256 - fy) + bottom * fy) >> 8) << shift;
+			}
+			return result;
+		}
+
+		// Clamps every 8 bit channel of pixel between the min and max of that channel over the 4 neighbours
+		inline uint32_t ClampToNeighbourhood(uint32_t pixel, const uint32_t* pNeighbours)
+		{
+#if defined(DAE_SIMD_SSE)
+			const __m128i neighbours{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pNeighbours)) };
+			// Reduce the 4 pixels to the lowest lane, the bytes of the channels stay in place
+			__m128i minimum{ _mm_min_epu8(neighbours, _mm_shuffle_epi32(neighbours, _MM_SHUFFLE(1, 0, 3, 2))) };
+			minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+			__m128i maximum{ _mm_max_epu8(neighbours, _mm_shuffle_epi32(neighbours, _MM_SHUFFLE(1, 0, 3, 2))) };
+			maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+			const __m128i clamped{ _mm_min_epu8(_mm_max_epu8(_mm_cvtsi32_si128(static_cast<int>(pixel)), minimum), maximum) };
+			return static_cast<uint32_t>(_mm_cvtsi128_si32(clamped));
+#else
+			uint32_t result{};
+			for (uint32_t shift{}; shift < 32; shift += 8)
+			{
+				uint32_t minimum{ 0xFF };
+				uint32_t maximum{};
+				for (int i{}; i < 4; ++i)
+				{
+					minimum = std::min(minimum, (pNeighbours[i] >> shift) & 0xFF);
+					maximum = std::max(maximum, (pNeighbours[i] >> shift) & 0xFF);
+				}
+				result |= std::clamp((pixel >> shift) & 0xFF, minimum, maximum) << shift;
+			}
+			return result;
+#endif
+		}
+
+		// Per 8 bit channel average of 4 pixels, rounded
+		inline uint32_t AveragePixels(const uint32_t* pPixels)
+		{
+#if defined(DAE_SIMD_SSE)
+			const __m128i zero{ _mm_setzero_si128() };
+			const __m128i pixels{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixels)) };
+			// 16 bit sums, pixels 0 + 2 and 1 + 3 first, then the two halves
+			__m128i sum{ _mm_add_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero)) };
+			sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+			const __m128i average{ _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2) };
+			return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(average, average)));
+#else
+			uint32_t result{};
+			for (uint32_t shift{}; shift < 32; shift += 8)
+			{
+				uint32_t sum{ 2 };
+				for (int i{}; i < 4; ++i)
+				{
+					sum += (pPixels[i] >> shift) & 0xFF;
+				}
+				result |= (sum >> 2) << shift;
+			}
+			return result;
+#endif
+		}
+
+		// Bilinear filter of one output row between the source rows pRow0 and pRow1.
+		// Output pixel i reads the source columns pX0[i] and pX1[i] with horizontal weight pFx[i].
+		inline void BilinearRow(const uint32_t* pRow0, const uint32_t* pRow1, uint32_t fy, const uint32_t* pX0, const uint32_t* pX1, const uint16_t* pFx, uint32_t* pDestination, size_t count)
+		{
+			size_t i{};
+#if defined(DAE_SIMD_SSE)
+			// 2 pixels per iteration, the channels are widened to 16 bit so a weighted sum of two of them tops out at 255 * 256
+			const __m128i zero{ _mm_setzero_si128() };
+			const __m128i one{ _mm_set1_epi16(256) };
+			const __m128i wy1{ _mm_set1_epi16(static_cast<short>(fy)) };
+			const __m128i wy0{ _mm_sub_epi16(one, wy1) };
+			auto gather = [zero](const uint32_t* pRow, uint32_t xA, uint32_t xB)
+				{
+					return _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(static_cast<int>(pRow[xA])), _mm_cvtsi32_si128(static_cast<int>(pRow[xB]))), zero);
+				};
+			for (; i + 2 <= count; i += 2)
+			{
+				const __m128i wx1{ _mm_unpacklo_epi64(_mm_set1_epi16(static_cast<short>(pFx[i])), _mm_set1_epi16(static_cast<short>(pFx[i + 1]))) };
+				const __m128i wx0{ _mm_sub_epi16(one, wx1) };
+
+				const __m128i top{ _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(gather(pRow0, pX0[i], pX0[i + 1]), wx0), _mm_mullo_epi16(gather(pRow0, pX1[i], pX1[i + 1]), wx1)), 8) };
+				const __m128i bottom{ _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(gather(pRow1, pX0[i], pX0[i + 1]), wx0), _mm_mullo_epi16(gather(pRow1, pX1[i], pX1[i + 1]), wx1)), 8) };
+				const __m128i result{ _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(top, wy0), _mm_mullo_epi16(bottom, wy1)), 8) };
+
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(pDestination + i), _mm_packus_epi16(result, result));
+			}
+#endif
+			for (; i < count; ++i)
+			{
+				pDestination[i] = BilinearPixel(pRow0[pX0[i]], pRow0[pX1[i]], pRow1[pX0[i]], pRow1[pX1[i]], pFx[i], fy);
+			}
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace dae
+{
+	/**
+	 * \brief Bounded lock-free queue for exactly one producer thread and one consumer thread.
+	 * The producer only writes the tail and the consumer only writes the head, so a push or pop is a plain copy and one release store.
+	 * Each side keeps a cached copy of the other side's index and only reloads it when the queue looks full/empty,
+	 * so in the common case neither thread touches the other's cache line.
+	 */
+	template<typename T, size_t Capacity>
+	class SPSCQueue final
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+	public:
+		SPSCQueue() = default;
+
+		SPSCQueue(const SPSCQueue& other) = delete;
+		SPSCQueue& operator=(const SPSCQueue& other) = delete;
+		SPSCQueue(SPSCQueue&& other) = delete;
+		SPSCQueue& operator=(SPSCQueue&& other) = delete;
+
+		// Producer side, false when the queue is full
+		bool TryPush(const T& item)
+		{
+			const size_t tail{ m_Tail.load(std::memory_order_relaxed) };
+			if (tail - m_CachedHead == Capacity)
+			{
+				m_CachedHead = m_Head.load(std::memory_order_acquire);
+				if (tail - m_CachedHead == Capacity) return false;
+			}
+
+			m_Items[tail & (Capacity - 1)] = item;
+			m_Tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side, false when the queue is empty
+		bool TryPop(T& item)
+		{
+			const size_t head{ m_Head.load(std::memory_order_relaxed) };
+			if (head == m_CachedTail)
+			{
+				m_CachedTail = m_Tail.load(std::memory_order_acquire);
+				if (head == m_CachedTail) return false;
+			}
+
+			item = m_Items[head & (Capacity - 1)];
+			m_Head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side
+		bool IsEmpty() const { return m_Head.load(std::memory_order_relaxed) == m_Tail.load(std::memory_order_acquire); }
+
+	private:
+		static constexpr size_t m_CacheLineSize{ 64 };
+
+		// Written by the producer
+		alignas(m_CacheLineSize) std::atomic<size_t> m_Tail{};
+		size_t m_CachedHead{};
+
+		// Written by the consumer
+		alignas(m_CacheLineSize) std::atomic<size_t> m_Head{};
+		size_t m_CachedTail{};
+
+		alignas(m_CacheLineSize) std::array<T, Capacity> m_Items{};
+	};
+}
@@ -0,0 +1,203 @@
+#include "pch.h"
+#include "ShadowMap.h"
+#include "Mesh.h"
+#include "Profiler.h"
+
+namespace dae
+{
+	ShadowMap::ShadowMap(int size)
+		:m_Size{ size }
+		,m_Depth(static_cast<size_t>(size) * size, FLT_MAX)
+	{
+	}
+
+	bool ShadowMap::Update(const Vector3& lightDirection, const std::vector<const UntexturedMesh*>& casters)
+	{
+		DAE_PROFILE_ZONE("Shadow map");
+		if (!HasChanged(lightDirection, casters)) return false;
+
+		Build(lightDirection, casters);
+		return true;
+	}
+
+	bool ShadowMap::HasChanged(const Vector3& lightDirection, const std::vector<const UntexturedMesh*>& casters) const
+	{
+		if (!m_IsBuilt || casters.size() != m_CasterMatrices.size()) return true;
+
+		if (lightDirection.x != m_LightDirection.x || lightDirection.y != m_LightDirection.y || lightDirection.z != m_LightDirection.z) return true;
+
+		for (size_t i{}; i < casters.size(); ++i)
+		{
+			if (casters[i]->GetWorldMatrix() != m_CasterMatrices[i]) return true;
+		}
+		return false;
+	}
+
+	void ShadowMap::Build(const Vector3& lightDirection, const std::vector<const UntexturedMesh*>& casters)
+	{
+		m_LightDirection = lightDirection;
+		m_Forward = lightDirection.Normalized();
+		const Vector3 worldUp{ abs(m_Forward.y) < .99f ? Vector3::UnitY : Vector3::UnitX };
+		m_Right = Vector3::Cross(worldUp, m_Forward).Normalized();
+		m_Up = Vector3::Cross(m_Forward, m_Right);
+
+		m_CasterMatrices.clear();
+		for (const UntexturedMesh* pCaster : casters)
+		{
+			m_CasterMatrices.push_back(pCaster->GetWorldMatrix());
+		}
+
+		// Casters in light space, the projection is fitted around their bounds
+		std::vector<std::vector<Vector3>> lightSpaceVertices(casters.size());
+		float minX{ FLT_MAX }, minY{ FLT_MAX };
+		float maxX{ -FLT_MAX }, maxY{ -FLT_MAX };
+		for (size_t casterIdx{}; casterIdx < casters.size(); ++casterIdx)
+		{
+			const UntexturedMesh& caster{ *casters[casterIdx] };
+			const AffineTransform& worldMatrix{ m_CasterMatrices[casterIdx] };
+			std::vector<Vector3>& vertices{ lightSpaceVertices[casterIdx] };
+			vertices.reserve(caster.vertices.size());
+			for (const Vertex& v : caster.vertices)
+			{
+				const Vector3 worldPosition{ worldMatrix.TransformPoint(v.position) };
+				const Vector3 lightSpace{ Vector3::Dot(worldPosition, m_Right), Vector3::Dot(worldPosition, m_Up), Vector3::Dot(worldPosition, m_Forward) };
+				minX = std::min(minX, lightSpace.x);
+				minY = std::min(minY, lightSpace.y);
+				maxX = std::max(maxX, lightSpace.x);
+				maxY = std::max(maxY, lightSpace.y);
+				vertices.push_back(lightSpace);
+			}
+		}
+
+		// One texel border so the PCF kernel stays inside the map
+		const float extent{ std::max(std::max(maxX - minX, maxY - minY), FLT_EPSILON) };
+		m_TexelsPerUnit = (m_Size - 2) / extent;
+		m_UnitsPerTexel = 1.f / m_TexelsPerUnit;
+		m_OffsetX = 1.f - minX * m_TexelsPerUnit;
+		m_OffsetY = 1.f - minY * m_TexelsPerUnit;
+
+		std::fill(m_Depth.begin(), m_Depth.end(), FLT_MAX);
+
+		for (size_t casterIdx{}; casterIdx < casters.size(); ++casterIdx)
+		{
+			const UntexturedMesh& caster{ *casters[casterIdx] };
+			std::vector<Vector3>& vertices{ lightSpaceVertices[casterIdx] };
+			for (Vector3& v : vertices)
+			{
+				v.x = v.x * m_TexelsPerUnit + m_OffsetX;
+				v.y = v.y * m_TexelsPerUnit + m_OffsetY;
+			}
+
+			switch (caster.primitiveTopology)
+			{
+			case PrimitiveTopology::TriangleList:
+				for (size_t i{}; i + 2 < caster.indices.size(); i += 3)
+				{
+					RasterizeDepth(vertices[caster.indices[i]], vertices[caster.indices[i + 1]], vertices[caster.indices[i + 2]]);
+				}
+				break;
+			case PrimitiveTopology::TriangleStrip:
+				// Winding doesn't matter, both sides cast
+				for (size_t i{}; i + 2 < caster.indices.size(); ++i)
+				{
+					RasterizeDepth(vertices[caster.indices[i]], vertices[caster.indices[i + 1]], vertices[caster.indices[i + 2]]);
+				}
+				break;
+			}
+		}
+
+		m_IsBuilt = true;
+		++m_RebuildCount;
+	}
+
+	void ShadowMap::RasterizeDepth(const Vector3& v0, const Vector3& v1, const Vector3& v2)
+	{
+		float area{ (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x) };
+		if (area == 0.f) return;
+
+		const int startX{ std::max(static_cast<int>(std::min(v0.x, std::min(v1.x, v2.x))), 0) };
+		const int startY{ std::max(static_cast<int>(std::min(v0.y, std::min(v1.y, v2.y))), 0) };
+		const int endX{ std::min(static_cast<int>(std::max(v0.x, std::max(v1.x, v2.x))) + 1, m_Size) };
+		const int endY{ std::min(static_cast<int>(std::max(v0.y, std::max(v1.y, v2.y))) + 1, m_Size) };
+		if (startX >= endX || startY >= endY) return;
+
+		// Both windings are rasterized, flip the edges of clockwise triangles
+		const float sign{ area < 0.f ? -1.f : 1.f };
+		area *= sign;
+
+		// Edge functions, stepped incrementally over the bounding box (pixel centers)
+		const float stepX0{ -(v2.y - v1.y) * sign }, stepY0{ (v2.x - v1.x) * sign };
+		const float stepX1{ -(v0.y - v2.y) * sign }, stepY1{ (v0.x - v2.x) * sign };
+		const float stepX2{ -(v1.y - v0.y) * sign }, stepY2{ (v1.x - v0.x) * sign };
+
+		const float startPx{ startX + .5f };
+		const float startPy{ startY + .5f };
+		float rowEdge0{ ((v2.x - v1.x) * (startPy - v1.y) - (v2.y - v1.y) * (startPx - v1.x)) * sign };
+		float rowEdge1{ ((v0.x - v2.x) * (startPy - v2.y) - (v0.y - v2.y) * (startPx - v2.x)) * sign };
+		float rowEdge2{ ((v1.x - v0.x) * (startPy - v0.y) - (v1.y - v0.y) * (startPx - v0.x)) * sign };
+
+		// Orthographic, so depth is linear in screen space
+		const float invArea{ 1.f / area };
+		const float depthStepX{ (stepX0 * v0.z + stepX1 * v1.z + stepX2 * v2.z) * invArea };
+		const float depthStepY{ (stepY0 * v0.z + stepY1 * v1.z + stepY2 * v2.z) * invArea };
+		float rowDepth{ (rowEdge0 * v0.z + rowEdge1 * v1.z + rowEdge2 * v2.z) * invArea };
+
+		for (int py{ startY }; py < endY; ++py)
+		{
+			float edge0{ rowEdge0 }, edge1{ rowEdge1 }, edge2{ rowEdge2 };
+			float depth{ rowDepth };
+			float* pDepthRow{ m_Depth.data() + py * m_Size };
+
+			for (int px{ startX }; px < endX; ++px)
+			{
+				if (edge0 >= 0.f && edge1 >= 0.f && edge2 >= 0.f && depth < pDepthRow[px])
+				{
+					pDepthRow[px] = depth;
+				}
+				edge0 += stepX0;
+				edge1 += stepX1;
+				edge2 += stepX2;
+				depth += depthStepX;
+			}
+
+			rowEdge0 += stepY0;
+			rowEdge1 += stepY1;
+			rowEdge2 += stepY2;
+			rowDepth += depthStepY;
+		}
+	}
+
+	Vector3 ShadowMap::ToShadowSpace(const Vector3& worldPosition) const
+	{
+		return { Vector3::Dot(worldPosition, m_Right) * m_TexelsPerUnit + m_OffsetX,
+			Vector3::Dot(worldPosition, m_Up) * m_TexelsPerUnit + m_OffsetY,
+			Vector3::Dot(worldPosition, m_Forward) };
+	}
+
+	float ShadowMap::GetVisibility(const Vector3& worldPosition, const Vector3& normal) const
+	{
+		if (!m_IsBuilt) return 1.f;
+
+		// Normal offset of one texel, plus a constant bias of a couple of texels in depth
+		const Vector3 shadowPosition{ ToShadowSpace(worldPosition + normal * m_UnitsPerTexel) };
+		const float depth{ shadowPosition.z - 2.f * m_UnitsPerTexel };
+
+		const int centerX{ static_cast<int>(shadowPosition.x) };
+		const int centerY{ static_cast<int>(shadowPosition.y) };
+
+		int litCount{};
+		for (int y{ centerY - 1 }; y <= centerY + 1; ++y)
+		{
+			for (int x{ centerX - 1 }; x <= centerX + 1; ++x)
+			{
+				// Outside of the map nothing casts
+				if (x < 0 || y < 0 || x >= m_Size || y >= m_Size || depth <= m_Depth[x + y * m_Size])
+				{
+					++litCount;
+				}
+			}
+		}
+
+		return litCount / 9.f;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include "DataTypes.h"
+
+namespace dae
+{
+	class UntexturedMesh;
+
+	// Depth of the casters as seen from the directional light, orthographic and fitted around the casters.
+	// Rasterized depth only, and only rebuilt when the light direction or a caster's world matrix changed.
+	class ShadowMap final
+	{
+	public:
+		explicit ShadowMap(int size);
+		~ShadowMap() = default;
+
+		ShadowMap(const ShadowMap& other) = delete;
+		ShadowMap& operator=(const ShadowMap& other) = delete;
+		ShadowMap(ShadowMap&& other) = delete;
+		ShadowMap& operator=(ShadowMap&& other) = delete;
+
+		// Returns true when the map had to be rebuilt
+		bool Update(const Vector3& lightDirection, const std::vector<const UntexturedMesh*>& casters);
+
+		// Lit fraction of the 3x3 PCF kernel around the world position, the normal offsets the lookup against acne
+		float GetVisibility(const Vector3& worldPosition, const Vector3& normal) const;
+
+		int GetSize() const { return m_Size; }
+		int GetRebuildCount() const { return m_RebuildCount; }
+
+	private:
+		int m_Size{};
+		std::vector<float> m_Depth{};
+
+		// Light basis, depth is measured along the light direction in world units
+		Vector3 m_LightDirection{};
+		Vector3 m_Forward{};
+		Vector3 m_Right{};
+		Vector3 m_Up{};
+
+		// Light space to texels
+		float m_OffsetX{};
+		float m_OffsetY{};
+		float m_TexelsPerUnit{};
+		float m_UnitsPerTexel{};
+
+		std::vector<AffineTransform> m_CasterMatrices{};
+		bool m_IsBuilt{ false };
+		int m_RebuildCount{};
+
+		bool HasChanged(const Vector3& lightDirection, const std::vector<const UntexturedMesh*>& casters) const;
+		void Build(const Vector3& lightDirection, const std::vector<const UntexturedMesh*>& casters);
+
+		// x and y in texels, z is the depth along the light
+		Vector3 ToShadowSpace(const Vector3& worldPosition) const;
+		void RasterizeDepth(const Vector3& v0, const Vector3& v1, const Vector3& v2);
+	};
+}
@@ -1,20 +1,61 @@
 #include "pch.h"
 #include "Texture.h"
+#include "Profiler.h"
 #include "Vector2.h"
 #include <SDL_image.h>
+#include <cstring>
 
 #include "HelperFuncts.h"
 
 dae::Texture::Texture(ID3D11Device* pDevice, const std::string& filePath)
+	:m_FilePath{ filePath }
 {
-	m_pSurface = IMG_Load(filePath.c_str());
-	m_pSurfacePixels = reinterpret_cast<uint32_t*>(m_pSurface->pixels);
+	DAE_PROFILE_ZONE("Load texture");
+	std::unique_ptr<MipLevel> pMip{ LoadMip(filePath) };
+	m_Width = pMip->width;
+	m_Height = pMip->height;
+	m_pMipLevels.push_back(std::move(pMip));
 
+	// Software mip chain, the TextureManager evicts what is not needed
+	while (m_pMipLevels.back()->width > 1 || m_pMipLevels.back()->height > 1)
+	{
+		m_pMipLevels.push_back(Downsample(*m_pMipLevels.back()));
+	}
+
+	CreateResources(pDevice);
+}
+
+dae::Texture::Texture(ID3D11Device* pDevice, const ColorRGB& color, float alpha)
+	:m_Width{ 1 }
+	,m_Height{ 1 }
+{
+	const uint32_t r{ static_cast<uint32_t>(Saturate(color.r) * 255) };
+	const uint32_t g{ static_cast<uint32_t>(Saturate(color.g) * 255) };
+	const uint32_t b{ static_cast<uint32_t>(Saturate(color.b) * 255) };
+	const uint32_t a{ static_cast<uint32_t>(Saturate(alpha) * 255) };
+
+	auto pMip{ std::make_unique<MipLevel>() };
+	pMip->width = 1;
+	pMip->height = 1;
+	pMip->pixels.push_back(r | (g << 8) | (b << 16) | (a << 24));
+	m_pMipLevels.push_back(std::move(pMip));
+
+	CreateResources(pDevice);
+}
+
+dae::Texture::~Texture()
+{
+	SAFE_RELEASE(m_pResource);
+	SAFE_RELEASE(m_pShaderResourceView);
+}
+
+void dae::Texture::CreateResources(ID3D11Device* pDevice)
+{
 	// Texture description
 	const DXGI_FORMAT format{ DXGI_FORMAT_R8G8B8A8_UNORM };
 	D3D11_TEXTURE2D_DESC desc{};
-	desc.Width = m_pSurface->w;
-	desc.Height = m_pSurface->h;
+	desc.Width = m_Width;
+	desc.Height = m_Height;
 	desc.MipLevels = 1;
 	desc.ArraySize = 1;
 	desc.Format = format;
@@ -25,12 +66,14 @@ dae::Texture::Texture(ID3D11Device* pDevice, const std::string& filePath)
 	desc.CPUAccessFlags = 0;
 	desc.MiscFlags = 0;
 
-	// InitData SDL_Surface
+	// InitData, the full resolution level is always resident right after loading
+	const MipLevel& mip{ *m_pMipLevels.front() };
 	D3D11_SUBRESOURCE_DATA initData{};
-	initData.pSysMem = m_pSurface->pixels;
-	initData.SysMemPitch = static_cast<UINT>(m_pSurface->pitch);
-	initData.SysMemSlicePitch = static_cast<UINT>(m_pSurface->h * m_pSurface->pitch);
+	initData.pSysMem = mip.pixels.data();
+	initData.SysMemPitch = static_cast<UINT>(mip.width * sizeof(uint32_t));
+	initData.SysMemSlicePitch = static_cast<UINT>(mip.GetSizeInBytes());
 
+	// ID3D11Device is free threaded, so this is safe to do from the loading thread
 	HRESULT hr = pDevice->CreateTexture2D(&desc, &initData, &m_pResource);
 
 	// ShaderResourceView description
@@ -42,32 +85,60 @@ dae::Texture::Texture(ID3D11Device* pDevice, const std::string& filePath)
 	hr = pDevice->CreateShaderResourceView(m_pResource, &SRVDesc, &m_pShaderResourceView);
 }
 
-dae::Texture::~Texture()
+dae::ColorRGB dae::Texture::SampleLevel(const Vector2& uv, int level) const
 {
-	SAFE_RELEASE(m_pResource);
-	SAFE_RELEASE(m_pShaderResourceView);
+	const uint32_t pixel{ FetchTexel(uv, level) };
 
-	if (m_pSurface)
-	{
-		SDL_FreeSurface(m_pSurface);
-		m_pSurface = nullptr;
-	}
+	const constexpr float invClampVal{ 1 / 255.f };
+
+	return { (pixel & 0xFF) * invClampVal, ((pixel >> 8) & 0xFF) * invClampVal, ((pixel >> 16) & 0xFF) * invClampVal };
 }
 
-dae::ColorRGB dae::Texture::Sample(const Vector2& uv) const
+dae::ColorRGB dae::Texture::SampleLevel(const Vector2& uv, int level, float& alpha) const
 {
-	Uint8 r, g, b;
+	const uint32_t pixel{ FetchTexel(uv, level) };
 
-	const size_t x{ static_cast<size_t>(uv.x * m_pSurface->w) };
-	const size_t y{ static_cast<size_t>(uv.y * m_pSurface->h) };
+	const constexpr float invClampVal{ 1 / 255.f };
+
+	alpha = (pixel >> 24) * invClampVal;
+	return { (pixel & 0xFF) * invClampVal, ((pixel >> 8) & 0xFF) * invClampVal, ((pixel >> 16) & 0xFF) * invClampVal };
+}
 
-	const Uint32 pixel{ m_pSurfacePixels[x + y * m_pSurface->w] };
+int dae::Texture::CalculateMip(const Vector2& uvDdx, const Vector2& uvDdy) const
+{
+	// Texel footprint of a pixel, the longest axis decides
+	const Vector2 texelDdx{ uvDdx.x * m_Width, uvDdx.y * m_Height };
+	const Vector2 texelDdy{ uvDdy.x * m_Width, uvDdy.y * m_Height };
+	const float sqrFootprint{ std::max(texelDdx.SqrMagnitude(), texelDdy.SqrMagnitude()) };
 
-	SDL_GetRGB(pixel, m_pSurface->format, &r, &g, &b);
+	// NaN from degenerate helper lanes says nothing about the level, it samples the finest resident one and isn't recorded
+	if (std::isnan(sqrFootprint)) return GetFinestResidentMip();
 
-	const constexpr float invClampVal{ 1 / 255.f };
+	// log2(sqrt(x)) = 0.5 * log2(x)
+	const int level{ sqrFootprint > 1.f ? std::min(static_cast<int>(0.5f * FastLog2(sqrFootprint)), GetMipCount() - 1) : 0 };
+	RecordWantedMip(level);
+	return std::max(level, GetFinestResidentMip());
+}
 
-	return { r * invClampVal,g * invClampVal,b * invClampVal };
+void dae::Texture::RecordWantedMip(int level) const
+{
+	// Every quad of every tile job lands here, a plain load first so only a finer level than seen so far writes the cache line
+	int finestWantedMip{ m_FinestWantedMip.load(std::memory_order_relaxed) };
+	while (level < finestWantedMip)
+	{
+		// A failed exchange reloads finestWantedMip, another job may have recorded a finer level in between
+		if (m_FinestWantedMip.compare_exchange_weak(finestWantedMip, level, std::memory_order_relaxed)) return;
+	}
+}
+
+uint32_t dae::Texture::FetchTexel(const Vector2& uv, int level) const
+{
+	const MipLevel& mip{ *m_pMipLevels[level] };
+
+	const int x{ Clamp(static_cast<int>(uv.x * mip.width), 0, mip.width - 1) };
+	const int y{ Clamp(static_cast<int>(uv.y * mip.height), 0, mip.height - 1) };
+
+	return mip.pixels[x + y * mip.width];
 }
 
 ID3D11Texture2D* dae::Texture::GetResource() const
@@ -79,3 +150,143 @@ ID3D11ShaderResourceView* dae::Texture::GetShaderResourceView() const
 {
 	return m_pShaderResourceView;
 }
+
+int dae::Texture::GetFinestResidentMip() const
+{
+	for (int level{}; level < GetMipCount(); ++level)
+	{
+		if (m_pMipLevels[level]) return level;
+	}
+	return GetMipCount() - 1;
+}
+
+size_t dae::Texture::GetMipSizeInBytes(int level) const
+{
+	const size_t width{ static_cast<size_t>(std::max(m_Width >> level, 1)) };
+	const size_t height{ static_cast<size_t>(std::max(m_Height >> level, 1)) };
+	return width * height * sizeof(uint32_t);
+}
+
+size_t dae::Texture::GetResidentBytes() const
+{
+	size_t bytes{};
+	for (const auto& pMip : m_pMipLevels)
+	{
+		if (pMip) bytes += pMip->GetSizeInBytes();
+	}
+	return bytes;
+}
+
+void dae::Texture::SetMip(int level, std::unique_ptr<MipLevel> pMip)
+{
+	m_pMipLevels[level] = std::move(pMip);
+}
+
+std::unique_ptr<dae::MipLevel> dae::Texture::EvictMip(int level)
+{
+	return std::move(m_pMipLevels[level]);
+}
+
+std::unique_ptr<dae::MipLevel> dae::Texture::LoadMip(const std::string& filePath)
+{
+	SDL_Surface* pLoadedSurface{ IMG_Load(filePath.c_str()) };
+	if (!pLoadedSurface)
+	{
+		std::cout << "Texture: failed to load " << filePath << '\n';
+		auto pMip{ std::make_unique<MipLevel>() };
+		pMip->width = 1;
+		pMip->height = 1;
+		pMip->pixels.push_back(0xFFFF00FF);
+		return pMip;
+	}
+
+	// Everything is converted to RGBA32 so it matches DXGI_FORMAT_R8G8B8A8_UNORM and sampling doesn't need SDL_GetRGB
+	SDL_Surface* pSurface{ SDL_ConvertSurfaceFormat(pLoadedSurface, SDL_PIXELFORMAT_RGBA32, 0) };
+	SDL_FreeSurface(pLoadedSurface);
+
+	auto pMip{ std::make_unique<MipLevel>() };
+	pMip->width = pSurface->w;
+	pMip->height = pSurface->h;
+	pMip->pixels.resize(static_cast<size_t>(pSurface->w) * pSurface->h);
+
+	const uint8_t* pRow{ static_cast<const uint8_t*>(pSurface->pixels) };
+	for (int y{}; y < pSurface->h; ++y)
+	{
+		std::memcpy(&pMip->pixels[static_cast<size_t>(y) * pSurface->w], pRow + static_cast<size_t>(y) * pSurface->pitch, pSurface->w * sizeof(uint32_t));
+	}
+
+	SDL_FreeSurface(pSurface);
+	return pMip;
+}
+
+std::unique_ptr<dae::MipLevel> dae::Texture::Downsample(const MipLevel& mip)
+{
+	auto pResult{ std::make_unique<MipLevel>() };
+	pResult->width = std::max(mip.width / 2, 1);
+	pResult->height = std::max(mip.height / 2, 1);
+	pResult->pixels.resize(static_cast<size_t>(pResult->width) * pResult->height);
+
+	// 2x2 box filter per channel
+	for (int y{}; y < pResult->height; ++y)
+	{
+		const int y0{ std::min(y * 2, mip.height - 1) };
+		const int y1{ std::min(y * 2 + 1, mip.height - 1) };
+		for (int x{}; x < pResult->width; ++x)
+		{
+			const int x0{ std::min(x * 2, mip.width - 1) };
+			const int x1{ std::min(x * 2 + 1, mip.width - 1) };
+
+			const uint32_t p0{ mip.pixels[x0 + y0 * mip.width] };
+			const uint32_t p1{ mip.pixels[x1 + y0 * mip.width] };
+			const uint32_t p2{ mip.pixels[x0 + y1 * mip.width] };
+			const uint32_t p3{ mip.pixels[x1 + y1 * mip.width] };
+
+			uint32_t result{};
+			for (int shift{}; shift < 32; shift += 8)
+			{
+				const uint32_t sum{ ((p0 >> shift) & 0xFF) + ((p1 >> shift) & 0xFF) + ((p2 >> shift) & 0xFF) + ((p3 >> shift) & 0xFF) };
+				result |= ((sum + 2) / 4) << shift;
+			}
+			pResult->pixels[x + y * pResult->width] = result;
+		}
+	}
+
+	return pResult;
+}
+
+dae::TextureHandle::TextureHandle(JobSystem& jobSystem, ID3D11Device* pDevice, const std::string& filePath, const ColorRGB& placeholderColor, float placeholderAlpha)
+	:m_JobSystem{ jobSystem }
+	,m_pPlaceholder{ std::make_unique<Texture>(pDevice, placeholderColor, placeholderAlpha) }
+{
+	// Every texture is its own job, so the total load time is that of the slowest texture
+	m_LoadingJob = m_JobSystem.ScheduleBackground([this, pDevice, filePath]
+		{
+			m_pLoadedTexture = std::make_unique<Texture>(pDevice, filePath);
+		});
+}
+
+dae::TextureHandle::~TextureHandle()
+{
+	m_JobSystem.Wait(m_LoadingJob);
+}
+
+void dae::TextureHandle::OnResolved(ResolvedCallback callback)
+{
+	m_ResolvedCallback = std::move(callback);
+	if (m_ResolvedCallback)
+	{
+		m_ResolvedCallback(Get());
+	}
+}
+
+bool dae::TextureHandle::Resolve()
+{
+	if (IsReady() || !m_LoadingJob.IsDone() || !m_pLoadedTexture) return false;
+
+	m_pTexture = std::move(m_pLoadedTexture);
+	if (m_ResolvedCallback)
+	{
+		m_ResolvedCallback(m_pTexture.get());
+	}
+	return true;
+}
@@ -1,28 +1,124 @@
 #pragma once
 #include <SDL_surface.h>
+#include <atomic>
+#include <climits>
 #include <string>
+#include <vector>
+#include <functional>
 #include "ColorRGB.h"
+#include "JobSystem.h"
 
 namespace dae
 {
 	struct Vector2;
 
+	// One level of the software mip chain, pixels are stored as SDL_PIXELFORMAT_RGBA32
+	struct MipLevel final
+	{
+		int width{};
+		int height{};
+		std::vector<uint32_t> pixels{};
+
+		size_t GetSizeInBytes() const { return pixels.size() * sizeof(uint32_t); }
+	};
+
 	class Texture final
 	{
 	public:
 		Texture(ID3D11Device* pDevice, const std::string& filePath);
+		// 1x1 texture filled with a single color, used as placeholder while the real texture loads
+		Texture(ID3D11Device* pDevice, const ColorRGB& color, float alpha = 1.f);
 		~Texture();
 
-		ColorRGB Sample(const Vector2& uv) const;
+		Texture(const Texture& other) = delete;
+		Texture& operator=(const Texture& other) = delete;
+		Texture(Texture&& other) = delete;
+		Texture& operator=(Texture&& other) = delete;
+
+		// Samples the given mip level, see CalculateMip
+		ColorRGB SampleLevel(const Vector2& uv, int level) const;
+		// Same, also returns the alpha channel
+		ColorRGB SampleLevel(const Vector2& uv, int level, float& alpha) const;
+
+		// Mip level for the uv derivatives of a pixel quad, never finer than the finest resident level.
+		// The level it wanted before that clamp is recorded for TakeFinestWantedMip.
+		int CalculateMip(const Vector2& uvDdx, const Vector2& uvDdy) const;
 
 		ID3D11Texture2D* GetResource() const;
 		ID3D11ShaderResourceView* GetShaderResourceView() const;
 
+		const std::string& GetFilePath() const { return m_FilePath; }
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+
+		// ------ SOFTWARE MIP CHAIN ------
+		// Level 0 is the full resolution image, only a contiguous range [finest resident, coarsest] is kept in memory
+		int GetMipCount() const { return static_cast<int>(m_pMipLevels.size()); }
+		int GetFinestResidentMip() const;
+		bool IsMipResident(int level) const { return m_pMipLevels[level] != nullptr; }
+		size_t GetMipSizeInBytes(int level) const;
+		size_t GetResidentBytes() const;
+
+		// Finest level the rasterizer wanted since the previous call, INT_MAX when the texture wasn't sampled.
+		// Only call it while nothing renders.
+		int TakeFinestWantedMip() { return m_FinestWantedMip.exchange(INT_MAX, std::memory_order_relaxed); }
+
+		void SetMip(int level, std::unique_ptr<MipLevel> pMip);
+		std::unique_ptr<MipLevel> EvictMip(int level);
+
+		static std::unique_ptr<MipLevel> LoadMip(const std::string& filePath);
+		static std::unique_ptr<MipLevel> Downsample(const MipLevel& mip);
+
 	private:
-		SDL_Surface* m_pSurface{ nullptr };
-		uint32_t* m_pSurfacePixels{ nullptr };
+		std::string m_FilePath{};
+		int m_Width{};
+		int m_Height{};
+
+		std::vector<std::unique_ptr<MipLevel>> m_pMipLevels{};
+		// Written by the raster jobs, reset by TakeFinestWantedMip between frames
+		mutable std::atomic<int> m_FinestWantedMip{ INT_MAX };
 
 		ID3D11Texture2D* m_pResource{};
 		ID3D11ShaderResourceView* m_pShaderResourceView{};
+
+		void CreateResources(ID3D11Device* pDevice);
+		void RecordWantedMip(int level) const;
+		uint32_t FetchTexel(const Vector2& uv, int level) const;
+	};
+
+	// Texture that is still being loaded by a background job.
+	// Get() returns a flat placeholder until the load has finished, so it can be used from the first frame.
+	class TextureHandle final
+	{
+	public:
+		using ResolvedCallback = std::function<void(Texture*)>;
+
+		TextureHandle(JobSystem& jobSystem, ID3D11Device* pDevice, const std::string& filePath, const ColorRGB& placeholderColor, float placeholderAlpha = 1.f);
+		// Waits for the load, it still uses the device
+		~TextureHandle();
+
+		TextureHandle(const TextureHandle& other) = delete;
+		TextureHandle& operator=(const TextureHandle& other) = delete;
+		TextureHandle(TextureHandle&& other) = delete;
+		TextureHandle& operator=(TextureHandle&& other) = delete;
+
+		// Callback is invoked on the thread calling Resolve(), with the placeholder right away and with the loaded texture once it is ready
+		void OnResolved(ResolvedCallback callback);
+
+		// Polls the load without blocking, returns true the moment the texture became available
+		bool Resolve();
+		bool IsReady() const { return m_pTexture != nullptr; }
+
+		Texture* Get() const { return m_pTexture ? m_pTexture.get() : m_pPlaceholder.get(); }
+
+	private:
+		JobSystem& m_JobSystem;
+		JobHandle m_LoadingJob{};
+		// Written by the loading job, moved to m_pTexture by Resolve() once the job is done
+		std::unique_ptr<Texture> m_pLoadedTexture{};
+		std::unique_ptr<Texture> m_pTexture{};
+		std::unique_ptr<Texture> m_pPlaceholder{};
+
+		ResolvedCallback m_ResolvedCallback{};
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,222 @@
+#include "pch.h"
+#include "TextureManager.h"
+#include "Texture.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace dae
+{
+	TextureManager::TextureManager(JobSystem& jobSystem, size_t budgetBytes)
+		:m_BudgetBytes{ budgetBytes }
+		,m_JobSystem{ jobSystem }
+	{
+	}
+
+	TextureManager::~TextureManager()
+	{
+		// The jobs write into this manager
+		for (const JobHandle& job : m_StreamingJobs)
+		{
+			m_JobSystem.Wait(job);
+		}
+	}
+
+	void TextureManager::Register(Texture* pTexture)
+	{
+		if (FindEntry(pTexture)) return;
+
+		Entry entry{};
+		entry.pTexture = pTexture;
+		entry.requestedMip = pTexture->GetFinestResidentMip();
+		entry.lastUsedFrame.resize(pTexture->GetMipCount(), m_FrameIdx);
+		m_Entries.push_back(std::move(entry));
+	}
+
+	void TextureManager::Unregister(Texture* pTexture)
+	{
+		m_Entries.erase(std::remove_if(m_Entries.begin(), m_Entries.end(), [pTexture](const Entry& entry) { return entry.pTexture == pTexture; }), m_Entries.end());
+	}
+
+	bool TextureManager::Update()
+	{
+		CollectSampleFeedback();
+		++m_FrameIdx;
+
+		m_StreamingJobs.erase(std::remove_if(m_StreamingJobs.begin(), m_StreamingJobs.end(), [](const JobHandle& job) { return job.IsDone(); }), m_StreamingJobs.end());
+
+		const bool hasInstalled{ InstallResults() };
+		const bool hasEvicted{ EvictOverBudget() };
+		QueueStreamRequests();
+
+		return hasInstalled || hasEvicted;
+	}
+
+	TextureManager::Stats TextureManager::GetStats() const
+	{
+		Stats stats{ m_Stats };
+		stats.residentBytes = GetResidentBytes();
+		stats.budgetBytes = m_BudgetBytes;
+		stats.averageLatencyMs = m_Stats.streamedMips > 0 ? m_TotalLatencyMs / m_Stats.streamedMips : 0.f;
+		return stats;
+	}
+
+	TextureManager::Entry* TextureManager::FindEntry(Texture* pTexture)
+	{
+		const auto it{ std::find_if(m_Entries.begin(), m_Entries.end(), [pTexture](const Entry& entry) { return entry.pTexture == pTexture; }) };
+		return it != m_Entries.end() ? &(*it) : nullptr;
+	}
+
+	size_t TextureManager::GetResidentBytes() const
+	{
+		size_t bytes{};
+		for (const Entry& entry : m_Entries)
+		{
+			bytes += entry.pTexture->GetResidentBytes();
+		}
+		return bytes;
+	}
+
+	void TextureManager::CollectSampleFeedback()
+	{
+		for (Entry& entry : m_Entries)
+		{
+			// Not sampled last frame, the request stays and its levels age towards eviction
+			const int wantedMip{ entry.pTexture->TakeFinestWantedMip() };
+			if (wantedMip == INT_MAX) continue;
+
+			// Residency only changes in here, so it is what every quad of the last frame was clamped to
+			const int finestResidentMip{ entry.pTexture->GetFinestResidentMip() };
+			entry.requestedMip = wantedMip;
+			entry.lastUsedFrame[std::max(wantedMip, finestResidentMip)] = m_FrameIdx;
+			if (wantedMip < finestResidentMip)
+			{
+				++m_Stats.misses;
+			}
+		}
+	}
+
+	bool TextureManager::InstallResults()
+	{
+		std::vector<StreamResult> results{};
+		{
+			std::lock_guard lock{ m_Mutex };
+			results.swap(m_Results);
+		}
+
+		for (StreamResult& result : results)
+		{
+			Entry* pEntry{ FindEntry(result.pTexture) };
+			if (!pEntry) continue;
+
+			for (int i{}; i < static_cast<int>(result.pMips.size()); ++i)
+			{
+				pEntry->pTexture->SetMip(result.finestMip + i, std::move(result.pMips[i]));
+				pEntry->lastUsedFrame[result.finestMip + i] = m_FrameIdx;
+			}
+			pEntry->isStreaming = false;
+
+			const float latencyMs{ std::chrono::duration<float, std::milli>(Clock::now() - result.requestTime).count() };
+			m_TotalLatencyMs += latencyMs * result.pMips.size();
+			m_Stats.maxLatencyMs = std::max(m_Stats.maxLatencyMs, latencyMs);
+			m_Stats.streamedMips += static_cast<uint32_t>(result.pMips.size());
+		}
+
+		return !results.empty();
+	}
+
+	bool TextureManager::EvictOverBudget()
+	{
+		size_t residentBytes{ GetResidentBytes() };
+		std::vector<std::unique_ptr<MipLevel>> pEvictedMips{};
+
+		while (residentBytes > m_BudgetBytes)
+		{
+			// Only the finest resident level of a texture can go, so the chain stays contiguous and the coarsest level always stays.
+			// Levels that were sampled last frame are kept.
+			Entry* pOldest{ nullptr };
+			uint64_t oldestFrame{ m_FrameIdx - 1 };
+			for (Entry& entry : m_Entries)
+			{
+				if (entry.isStreaming) continue;
+
+				const int finestMip{ entry.pTexture->GetFinestResidentMip() };
+				if (finestMip >= entry.pTexture->GetMipCount() - 1) continue;
+
+				if (entry.lastUsedFrame[finestMip] < oldestFrame)
+				{
+					oldestFrame = entry.lastUsedFrame[finestMip];
+					pOldest = &entry;
+				}
+			}
+			if (!pOldest) break;
+
+			std::unique_ptr<MipLevel> pMip{ pOldest->pTexture->EvictMip(pOldest->pTexture->GetFinestResidentMip()) };
+			residentBytes -= pMip->GetSizeInBytes();
+			pEvictedMips.push_back(std::move(pMip));
+			++m_Stats.evictedMips;
+		}
+
+		if (pEvictedMips.empty()) return false;
+
+		// Freeing the pixel data is left to a background job, std::function needs a copyable capture
+		auto pMipsToFree{ std::make_shared<std::vector<std::unique_ptr<MipLevel>>>(std::move(pEvictedMips)) };
+		m_StreamingJobs.push_back(m_JobSystem.ScheduleBackground([pMipsToFree] { pMipsToFree->clear(); }));
+		return true;
+	}
+
+	void TextureManager::QueueStreamRequests()
+	{
+		size_t residentBytes{ GetResidentBytes() };
+
+		for (Entry& entry : m_Entries)
+		{
+			const int finestResident{ entry.pTexture->GetFinestResidentMip() };
+			if (entry.isStreaming || entry.requestedMip >= finestResident) continue;
+
+			// Stream in as many of the requested levels as the budget allows, starting from the coarsest missing one
+			int finestMip{ finestResident };
+			while (finestMip > entry.requestedMip && residentBytes + entry.pTexture->GetMipSizeInBytes(finestMip - 1) <= m_BudgetBytes)
+			{
+				--finestMip;
+				residentBytes += entry.pTexture->GetMipSizeInBytes(finestMip);
+			}
+			if (finestMip == finestResident) continue;
+
+			entry.isStreaming = true;
+
+			// One job per texture, so textures stream in parallel
+			const StreamRequest request{ entry.pTexture, entry.pTexture->GetFilePath(), finestMip, finestResident, Clock::now() };
+			m_StreamingJobs.push_back(m_JobSystem.ScheduleBackground([this, request]
+				{
+					StreamResult result{ Stream(request) };
+
+					std::lock_guard lock{ m_Mutex };
+					m_Results.push_back(std::move(result));
+				}));
+		}
+	}
+
+	TextureManager::StreamResult TextureManager::Stream(const StreamRequest& request) const
+	{
+		DAE_PROFILE_ZONE("Stream mip");
+		StreamResult result{};
+		result.pTexture = request.pTexture;
+		result.finestMip = request.finestMip;
+		result.requestTime = request.requestTime;
+
+		// Fine mips are rebuilt from the full resolution image on disk
+		std::unique_ptr<MipLevel> pMip{ Texture::LoadMip(request.filePath) };
+		for (int level{}; level < request.endMip; ++level)
+		{
+			std::unique_ptr<MipLevel> pNextMip{ Texture::Downsample(*pMip) };
+			if (level >= request.finestMip)
+			{
+				result.pMips.push_back(std::move(pMip));
+			}
+			pMip = std::move(pNextMip);
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include "JobSystem.h"
+
+namespace dae
+{
+	class Texture;
+	struct MipLevel;
+
+	// Keeps the software mip chains of the registered textures under a byte budget.
+	// Driven by the levels the rasterizer wanted last frame (Texture::TakeFinestWantedMip):
+	// missing fine mips are streamed in from disk by background jobs, least recently used mips are evicted.
+	class TextureManager final
+	{
+	public:
+		struct Stats
+		{
+			size_t residentBytes{};
+			size_t budgetBytes{};
+			uint32_t misses{};			// frames a texture was sampled coarser than wanted, the finer mip wasn't resident
+			uint32_t streamedMips{};
+			uint32_t evictedMips{};
+			float averageLatencyMs{};	// request -> mip resident
+			float maxLatencyMs{};
+		};
+
+		TextureManager(JobSystem& jobSystem, size_t budgetBytes);
+		~TextureManager();
+
+		TextureManager(const TextureManager& other) = delete;
+		TextureManager& operator=(const TextureManager& other) = delete;
+		TextureManager(TextureManager&& other) = delete;
+		TextureManager& operator=(TextureManager&& other) = delete;
+
+		void Register(Texture* pTexture);
+		void Unregister(Texture* pTexture);
+
+		// Sync point, call once per frame while nothing renders.
+		// Collects what the previous frame sampled, installs streamed mips, evicts over budget and queues new stream requests.
+		// Returns true when resident mips came or went, what was rendered with the old ones is out of date.
+		bool Update();
+
+		void SetBudget(size_t budgetBytes) { m_BudgetBytes = budgetBytes; }
+		Stats GetStats() const;
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Entry
+		{
+			Texture* pTexture{};
+			int requestedMip{};
+			bool isStreaming{ false };
+			std::vector<uint64_t> lastUsedFrame{};
+		};
+
+		struct StreamRequest
+		{
+			Texture* pTexture{};
+			std::string filePath{};
+			int finestMip{};
+			int endMip{};	// exclusive, finest resident level when the request was made
+			Clock::time_point requestTime{};
+		};
+
+		struct StreamResult
+		{
+			Texture* pTexture{};
+			int finestMip{};
+			std::vector<std::unique_ptr<MipLevel>> pMips{};
+			Clock::time_point requestTime{};
+		};
+
+		// Render thread only
+		std::vector<Entry> m_Entries{};
+		uint64_t m_FrameIdx{};
+		size_t m_BudgetBytes{};
+		Stats m_Stats{};
+		float m_TotalLatencyMs{};
+
+		// Shared with the streaming jobs
+		JobSystem& m_JobSystem;
+		std::vector<JobHandle> m_StreamingJobs{};
+		mutable std::mutex m_Mutex{};
+		std::vector<StreamResult> m_Results{};
+
+		Entry* FindEntry(Texture* pTexture);
+		size_t GetResidentBytes() const;
+		void CollectSampleFeedback();
+		bool InstallResults();
+		bool EvictOverBudget();
+		void QueueStreamRequests();
+
+		StreamResult Stream(const StreamRequest& request) const;
+	};
+}
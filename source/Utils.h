@@ -3,6 +3,7 @@
 #include "Math.h"
 #include "Vector3.h"
 #include "ColorRGB.h"
+#include "SIMD.h"
 
 namespace dae
 {
@@ -237,5 +238,68 @@ namespace dae
 			}
 			return { PSR,PSR,PSR };
 		}
+
+		// Fragments lit together, structure of arrays so every fragment maps onto one SSE lane
+		constexpr int BatchSize{ 4 };
+		struct FragmentBatch
+		{
+			float normalX[BatchSize]{};
+			float normalY[BatchSize]{};
+			float normalZ[BatchSize]{};
+			float viewX[BatchSize]{};
+			float viewY[BatchSize]{};
+			float viewZ[BatchSize]{};
+			float exponent[BatchSize]{};
+		};
+
+		struct FragmentBatchLighting
+		{
+			float observedArea[BatchSize]{};
+			float phong[BatchSize]{};
+		};
+
+		/**
+		 * \brief Observed area (the Lambert cosine) and Phong specular of a whole batch in one pass.
+		 * The specular power uses FastPow, max absolute error 1.5e-4 compared to powf for exponents in [0, 25].
+		 * \param l Incoming (incident) Light Direction, shared by the batch
+		 * \param batch Normals, view directions and Phong exponents
+		 * \param lighting Receives the clamped observed area and the specular term with ks = 1
+		 */
+		inline void PhongLambert(const Vector3& l, const FragmentBatch& batch, FragmentBatchLighting& lighting)
+		{
+#if defined(DAE_SIMD_SSE)
+			const __m128 lx{ _mm_set1_ps(l.x) };
+			const __m128 ly{ _mm_set1_ps(l.y) };
+			const __m128 lz{ _mm_set1_ps(l.z) };
+
+			const __m128 nx{ _mm_loadu_ps(batch.normalX) };
+			const __m128 ny{ _mm_loadu_ps(batch.normalY) };
+			const __m128 nz{ _mm_loadu_ps(batch.normalZ) };
+
+			const __m128 lDotN{ SIMD::Dot(lx, ly, lz, nx, ny, nz) };
+			_mm_storeu_ps(lighting.observedArea, SIMD::Saturate(lDotN));
+
+			// reflect = l - 2 * dot(l, n) * n
+			const __m128 twoLDotN{ _mm_add_ps(lDotN, lDotN) };
+			const __m128 rx{ _mm_sub_ps(lx, _mm_mul_ps(twoLDotN, nx)) };
+			const __m128 ry{ _mm_sub_ps(ly, _mm_mul_ps(twoLDotN, ny)) };
+			const __m128 rz{ _mm_sub_ps(lz, _mm_mul_ps(twoLDotN, nz)) };
+
+			const __m128 alfa{ SIMD::Saturate(SIMD::Dot(rx, ry, rz, _mm_loadu_ps(batch.viewX), _mm_loadu_ps(batch.viewY), _mm_loadu_ps(batch.viewZ))) };
+			const __m128 phong{ SIMD::FastPow(alfa, _mm_loadu_ps(batch.exponent)) };
+			_mm_storeu_ps(lighting.phong, _mm_and_ps(phong, _mm_cmpgt_ps(alfa, _mm_setzero_ps())));
+#else
+			for (int i{}; i < BatchSize; ++i)
+			{
+				const Vector3 n{ batch.normalX[i], batch.normalY[i], batch.normalZ[i] };
+				const Vector3 v{ batch.viewX[i], batch.viewY[i], batch.viewZ[i] };
+
+				lighting.observedArea[i] = Vector3::DotClamp(l, n);
+
+				const float alfa{ Vector3::DotClamp(Vector3::Reflect(l, n), v) };
+				lighting.phong[i] = alfa > 0 ? FastPow(alfa, batch.exponent[i]) : 0.f;
+			}
+#endif
+		}
 	}
 }
\ No newline at end of file
@@ -6,10 +6,17 @@
 
 #undef main
 #include "Renderer.h"
+#include "Benchmark.h"
 
 #include "HelperFuncts.h"
+#include "InputEvent.h"
+#include "Profiler.h"
 
 #include <Windows.h>
+#include <thread>
+#include <atomic>
+#include <charconv>
+#include <cstring>
 
 using namespace dae;
 
@@ -24,50 +31,54 @@ void enableColors()
 	}
 }
 
+// Whole number >= 0 and nothing after it, count is left alone otherwise
+bool ParseCount(const char* text, int& count)
+{
+	const char* pTextEnd{ text + std::strlen(text) };
+	int value{};
+	const auto [pParseEnd, error] { std::from_chars(text, pTextEnd, value) };
+	if (error != std::errc{} || pParseEnd != pTextEnd || pParseEnd == text || value < 0) return false;
+
+	count = value;
+	return true;
+}
+
+void PrintUsage(const char* argument)
+{
+	std::cout << YELLOW << "Ignoring " << argument << ", usage: DualRasterizer [--benchmark] [--workers N] [--max-fps N]\n"
+		<< "  --workers N   job system workers besides the frame thread, 0 or more (default: one per core)\n"
+		<< "  --max-fps N   render rate cap, 0 or more (default: 0, uncapped)\n" << RESET;
+}
+
 void ShutDown(SDL_Window* pWindow)
 {
 	SDL_DestroyWindow(pWindow);
 	SDL_Quit();
 }
 
-int main(int argc, char* args[])
+// Update and render loop, on its own thread. Stops at the quit event.
+// maxFps caps the render rate, 0 renders as fast as it can. The simulation runs at a fixed rate either way.
+void RunFrames(SDL_Window* pWindow, int nrWorkers, int maxFps, InputQueue& inputQueue)
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
-
-	enableColors();
-
-	//Create window + surfaces
-	SDL_Init(SDL_INIT_VIDEO);
-
-	const uint32_t width = 640;
-	const uint32_t height = 480;
-
-	SDL_Window* pWindow = SDL_CreateWindow(
-		"DualRasterizer - Re Messely/2DAE15",
-		SDL_WINDOWPOS_UNDEFINED,
-		SDL_WINDOWPOS_UNDEFINED,
-		width, height, 0);
-
-	if (!pWindow)
-		return 1;
-
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	const auto pRenderer = new Renderer(pWindow, nrWorkers);
 
 	//Start loop
 	pTimer->Start();
 	float printTimer = 0.f;
 	bool isLooping = true;
 	bool displayFPS = false;
+	std::chrono::steady_clock::time_point nextFrameTime{ std::chrono::steady_clock::now() };
 	while (isLooping)
 	{
 		//--------- Get input events ---------
-		SDL_Event e;
-		while (SDL_PollEvent(&e))
+		// Drained right before the update, as late as possible for this frame
+		InputEvent input{};
+		while (inputQueue.TryPop(input))
 		{
+			const SDL_Event& e{ input.event };
+			pRenderer->HandleInput(input);
 			switch (e.type)
 			{
 			case SDL_QUIT:
@@ -100,6 +111,36 @@ int main(int argc, char* args[])
 				case SDL_SCANCODE_F8:
 					pRenderer->ToggleBoundingBoxVisualisation();
 					break;
+				case SDL_SCANCODE_1:
+					pRenderer->ToggleLocalLights();
+					break;
+				case SDL_SCANCODE_2:
+					pRenderer->ToggleShadows();
+					break;
+				case SDL_SCANCODE_3:
+					pRenderer->ToggleZPrepass();
+					break;
+				case SDL_SCANCODE_4:
+					pRenderer->ToggleFramePipelining();
+					break;
+				case SDL_SCANCODE_5:
+					pRenderer->CycleLatencyMode();
+					break;
+				case SDL_SCANCODE_6:
+					pRenderer->ToggleDynamicResolution();
+					break;
+				case SDL_SCANCODE_7:
+					pRenderer->ToggleCheckerboard();
+					break;
+				case SDL_SCANCODE_8:
+					pRenderer->ToggleVariableRateShading();
+					break;
+				case SDL_SCANCODE_9:
+					pRenderer->ToggleShadingRateVisualisation();
+					break;
+				case SDL_SCANCODE_0:
+					pRenderer->ToggleIncrementalRendering();
+					break;
 				case SDL_SCANCODE_F9:
 					pRenderer->CycleCullModes();
 					break;
@@ -117,19 +158,38 @@ int main(int argc, char* args[])
 		}
 
 		//--------- Update ---------
+		// Runs while the previous frame is still rendering
 		pRenderer->Update(pTimer);
 
 		//--------- Render ---------
 		pRenderer->Render();
+		// Nothing to draw, sleep until input arrives instead of spinning.
+		// Still wakes up now and then for textures that finish streaming in.
+		for (int i{}; pRenderer->IsIdle() && i < 16 && inputQueue.IsEmpty(); ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+		}
+
+		//--------- Frame cap ---------
+		if (maxFps > 0)
+		{
+			// Against a schedule instead of the last frame, so oversleeping once doesn't lower the rate
+			nextFrameTime = std::max(nextFrameTime + std::chrono::microseconds{ 1'000'000 / maxFps }, std::chrono::steady_clock::now() - std::chrono::milliseconds{ 100 });
+			std::this_thread::sleep_until(nextFrameTime);
+		}
 
 		//--------- Timer ---------
+		Profiler::EndFrame();
 		pTimer->Update();
 		printTimer += pTimer->GetElapsed();
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
 			if (displayFPS)
+			{
 				std::cout << WHITE << "dFPS: " << pTimer->GetdFPS() << '\n' << RESET;
+				pRenderer->PrintStats();
+			}
 		}
 	}
 	pTimer->Stop();
@@ -137,6 +197,90 @@ int main(int argc, char* args[])
 	//Shutdown "framework"
 	delete pRenderer;
 	delete pTimer;
+}
+
+int main(int argc, char* args[])
+{
+	enableColors();
+
+	if (argc > 1 && std::string{ args[1] } == "--benchmark")
+	{
+		// A fast approximation that drifted out of its bounds fails the run
+		const bool isAccurate{ Benchmark::RunAccuracyChecks() };
+		Benchmark::RunMathBenchmarks();
+		Benchmark::RunPresentBenchmarks();
+		return isAccurate ? 0 : 1;
+	}
+
+	//Create window + surfaces
+	SDL_Init(SDL_INIT_VIDEO);
+
+	const uint32_t width = 640;
+	const uint32_t height = 480;
+
+	// Not resizable, the presenter updates the window surface from its own thread and a resize would recreate it (see Presenter.h)
+	SDL_Window* pWindow = SDL_CreateWindow(
+		"DualRasterizer - Re Messely/2DAE15",
+		SDL_WINDOWPOS_UNDEFINED,
+		SDL_WINDOWPOS_UNDEFINED,
+		width, height, 0);
+
+	if (!pWindow)
+		return 1;
+
+	// --workers N sets the job system worker count for scaling tests, the frame thread always joins in
+	// --max-fps N caps the render rate
+	// A missing or invalid value prints the usage and keeps the default
+	int nrWorkers{ -1 };
+	int maxFps{ 0 };
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ args[i] };
+		if (argument != "--workers" && argument != "--max-fps") continue;
+
+		int& count{ argument == "--workers" ? nrWorkers : maxFps };
+		if (i + 1 < argc && ParseCount(args[i + 1], count))
+		{
+			++i;
+		}
+		else
+		{
+			PrintUsage(i + 1 < argc ? (argument + ' ' + args[i + 1]).c_str() : argument.c_str());
+		}
+	}
+
+	// SDL only hands window events to the thread that created the window, so this thread stays behind as the input thread
+	// and the frames run on their own thread. Everything the renderer owns is created and destroyed over there.
+	const auto pInputQueue = new InputQueue();
+	std::atomic<bool> isFrameThreadDone{ false };
+	std::thread frameThread{ [&]
+		{
+			RunFrames(pWindow, nrWorkers, maxFps, *pInputQueue);
+			isFrameThreadDone = true;
+		} };
+
+	// Sleeps until SDL has an event, so every event is timestamped the moment it arrives, whatever the frame is doing
+	SDL_Event e{};
+	do
+	{
+		if (!SDL_WaitEvent(&e)) e.type = SDL_QUIT;
+
+		// Only full when the frame thread stalls, it drains the queue every frame
+		const InputEvent input{ e, std::chrono::steady_clock::now() };
+		while (!pInputQueue->TryPush(input))
+		{
+			std::this_thread::yield();
+		}
+	} while (e.type != SDL_QUIT);
+
+	// The window keeps receiving its messages while the renderer shuts down
+	while (!isFrameThreadDone)
+	{
+		SDL_PumpEvents();
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+	}
+	frameThread.join();
+	delete pInputQueue;
 
 	ShutDown(pWindow);
 	return 0;